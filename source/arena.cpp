@@ -0,0 +1,56 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+#include "arena.hpp"
+
+void *arena::allocate(size_t size, size_t align)
+{
+  if (!m_blocks.empty())
+    {
+      block &b = m_blocks.back();
+      uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+      size_t start = ((base + b.used + align - 1) & ~uintptr_t(align - 1)) - base;
+
+      if (start + size <= b.size)
+        {
+          b.used = start + size;
+          return b.data.get() + start;
+        }
+    }
+
+  /* new[] aligns for any fundamental type, larger alignments are padded for */
+  size_t need = size + (align > alignof(std::max_align_t)? align : 0);
+  size_t bytes = need > BLOCK_SIZE? need : BLOCK_SIZE;
+
+  m_blocks.push_back({std::unique_ptr<char[]>(new char[bytes]), bytes, 0});
+  return allocate(size, align);
+}
+
+void arena::clear()
+{
+  while (!m_cleanups.empty())
+    {
+      m_cleanups.back().destroy(m_cleanups.back().p);
+      m_cleanups.pop_back();
+    }
+
+  if (m_blocks.size() > 1)
+    m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+  if (!m_blocks.empty())
+    m_blocks.front().used = 0;
+}
@@ -0,0 +1,88 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Memory handed out in large blocks and given back all at once. The
+ * things made in an arena live until it is cleared or destroyed, then
+ * their destructors run in the reverse order of their making */
+class arena
+{
+  struct block
+  {
+    std::unique_ptr<char[]> data;
+    size_t size;
+    size_t used;
+  };
+
+  struct cleanup
+  {
+    void (*destroy)(void *);
+    void *p;
+  };
+
+  std::vector<block>   m_blocks;
+  std::vector<cleanup> m_cleanups;
+
+  template <class T>
+  static void destroy(void *p)
+  { static_cast<T *>(p)->~T(); }
+
+public:
+
+  /* Size of the blocks, larger things get a block of their own */
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  arena() = default;
+
+  arena(const arena &)            = delete;
+  arena& operator=(const arena &) = delete;
+
+  ~arena()
+  { clear(); }
+
+  void *allocate(size_t size, size_t align);
+
+  /* T is made in the arena. When its constructor throws, the memory
+   * stays with the arena and nothing leaks */
+  template <class T, class... Args>
+  T& make(Args&&... args)
+  {
+    void *p = allocate(sizeof(T), alignof(T));
+
+    if (!std::is_trivially_destructible<T>::value)
+      m_cleanups.reserve(m_cleanups.size() + 1);
+
+    T *made = new (p) T(std::forward<Args>(args)...);
+
+    if (!std::is_trivially_destructible<T>::value)
+      m_cleanups.push_back({destroy<T>, made});
+    return *made;
+  }
+
+  /* Destroy all the things made and keep the first block for reuse */
+  void clear();
+};
+
+#endif // ARENA_HPP
@@ -0,0 +1,306 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <unordered_map>
+#include <vector>
+
+#include "color.hpp"
+#include "utils.hpp"
+#include "scenario_constants.hpp"
+
+/* The ids an attribute can keep */
+#define COLOR_IDS 256
+
+struct color_combo
+{
+  int fg;
+  int bg;
+};
+
+/* Combinations of the ids past the basic pairs. The table only grows,
+ * so the painter thread reads it while the game adds new ones */
+static color_combo color_combos[COLOR_IDS];
+static int color_next = COLOR_BASIC_PAIRS + 1;
+static std::unordered_map<uint64_t, short> color_ids;
+
+static bool truecolor = false;
+
+static short color_nearest_id(int fg, int bg);
+
+/* Curses pairs: the basic ones are fixed, the others are shared by the ids
+ * folding to the same terminal colors */
+static int      pair_count = 0;
+static int      pair_free  = COLOR_BASIC_PAIRS + 1;
+static short    pair_of[COLOR_IDS];
+static int      pair_colors[COLOR_IDS];
+static unsigned pair_used[COLOR_IDS];
+static std::unordered_map<int, short> pair_by_colors;
+
+static unsigned rounds = 1;
+static unsigned evictions = 0;
+
+/* RGB of the basic and bright colors */
+static const uint8_t xterm_rgb[16][3] =
+{
+  {   0,   0,   0 }, /* COLOR_BLACK   */
+  { 205,   0,   0 }, /* COLOR_RED     */
+  {   0, 205,   0 }, /* COLOR_GREEN   */
+  { 205, 205,   0 }, /* COLOR_YELLOW  */
+  {   0,   0, 238 }, /* COLOR_BLUE    */
+  { 205,   0, 205 }, /* COLOR_MAGENTA */
+  {   0, 205, 205 }, /* COLOR_CYAN    */
+  { 229, 229, 229 }, /* COLOR_WHITE   */
+  { 127, 127, 127 },
+  { 255,   0,   0 },
+  {   0, 255,   0 },
+  { 255, 255,   0 },
+  {  92,  92, 255 },
+  { 255,   0, 255 },
+  {   0, 255, 255 },
+  { 255, 255, 255 },
+};
+
+void color_init()
+{
+  const char *colorterm = getenv("COLORTERM");
+  truecolor = colorterm && (!strcmp(colorterm, "truecolor") || !strcmp(colorterm, "24bit"));
+
+  pair_count = COLOR_PAIRS < COLOR_IDS ? COLOR_PAIRS : COLOR_IDS;
+
+  for (short i = 1; i <= COLOR_BASIC_PAIRS && i < pair_count; ++i)
+    init_pair(i, (i - 1)%8, (i - 1)/8);
+}
+
+attr_t color_pair(int fg, int bg)
+{
+  if (fg >= 0 && fg < 8 && bg >= 0 && bg < 8)
+    return PAIR(fg, bg);
+
+  uint64_t key = uint64_t(uint32_t(fg)) << 32 | uint32_t(bg);
+  auto found = color_ids.find(key);
+  if (found != color_ids.end())
+    return COLOR_PAIR(found->second);
+
+  /* The ids are used up: the combination is shown as the closest one made */
+  short id;
+  if (color_next == COLOR_IDS)
+    id = color_nearest_id(fg, bg);
+  else
+    {
+      id = short(color_next++);
+      color_combos[id] = {fg, bg};
+    }
+
+  color_ids.emplace(key, id);
+  return COLOR_PAIR(id);
+}
+
+int color_parse(const char *value)
+{
+  for (size_t i = 0; i < YAML_COLORS_SIZE; ++i)
+    if (!strcmp(value, YAML_COLORS[i]))
+      return int(i);
+
+  char *end;
+  if (value[0] == '#')
+    {
+      long rgb = strtol(value + 1, &end, 16);
+      if (strlen(value) == 7 && !*end && rgb >= 0)
+        return COLOR_RGB(int(rgb >> 16), int(rgb >> 8 & 0xff), int(rgb & 0xff));
+      return -1;
+    }
+
+  long index = strtol(value, &end, 10);
+  if (*value && !*end && index >= 0 && index < 256)
+    return int(index);
+  return -1;
+}
+
+/* The id, basic or made, whose colors are the closest to fg/bg */
+static short color_nearest_id(int fg, int bg)
+{
+  uint8_t want[2][3], have[3];
+  color_rgb(fg, want[0]);
+  color_rgb(bg, want[1]);
+
+  short nearest = 1;
+  long best = -1;
+  for (int id = 1; id < color_next; ++id)
+    {
+      attr_t attribute = attr_t(COLOR_PAIR(id));
+      long d = 0;
+      for (int side = 0; side < 2; ++side)
+        {
+          color_rgb(side ? color_bg(attribute) : color_fg(attribute), have);
+          for (int k = 0; k < 3; ++k)
+            d += long(want[side][k] - have[k]) * long(want[side][k] - have[k]);
+        }
+
+      if (best < 0 || d < best)
+        {
+          best = d;
+          nearest = short(id);
+        }
+    }
+  return nearest;
+}
+
+int color_fg(attr_t attribute)
+{
+  int id = PAIR_NUMBER(attribute);
+
+  if (!id)
+    return COLOR_WHITE;
+  return id <= COLOR_BASIC_PAIRS ? (id - 1)%8 : color_combos[id].fg;
+}
+
+int color_bg(attr_t attribute)
+{
+  int id = PAIR_NUMBER(attribute);
+
+  if (!id)
+    return COLOR_BLACK;
+  return id <= COLOR_BASIC_PAIRS ? (id - 1)/8 : color_combos[id].bg;
+}
+
+bool color_truecolor()
+{ return truecolor; }
+
+void color_rgb(int color, uint8_t rgb[3])
+{
+  static const uint8_t levels[6] = { 0, 95, 135, 175, 215, 255 };
+
+  if (color >= 256)
+    {
+      rgb[0] = uint8_t(color >> 16);
+      rgb[1] = uint8_t(color >> 8);
+      rgb[2] = uint8_t(color);
+    }
+  else if (color >= 232)
+    rgb[0] = rgb[1] = rgb[2] = uint8_t(8 + (color - 232) * 10);
+  else if (color >= 16)
+    {
+      rgb[0] = levels[(color - 16) / 36];
+      rgb[1] = levels[(color - 16) / 6 % 6];
+      rgb[2] = levels[(color - 16) % 6];
+    }
+  else
+    memcpy(rgb, xterm_rgb[color < 0 ? COLOR_WHITE : color], 3);
+}
+
+int color_nearest(int color, int colors)
+{
+  if (color >= 0 && color < colors && color < 256)
+    return color;
+
+  uint8_t rgb[3], c[3];
+  color_rgb(color, rgb);
+
+  int nearest = 0;
+  long best = -1;
+  for (int i = 0; i < colors && i < 256; ++i)
+    {
+      color_rgb(i, c);
+      long d = 0;
+      for (int k = 0; k < 3; ++k)
+        d += long(rgb[k] - c[k]) * long(rgb[k] - c[k]);
+
+      if (best < 0 || d < best)
+        {
+          best = d;
+          nearest = i;
+        }
+    }
+  return nearest;
+}
+
+/* Give the id a curses pair. Only here pairs are made */
+static short pair_allocate(int id)
+{
+  int colors = COLORS < 256 ? COLORS : 256;
+  int fg = color_nearest(color_combos[id].fg, colors);
+  int bg = color_nearest(color_combos[id].bg, colors);
+
+  /* No pairs left after the basic ones: show the closest basic colors */
+  if (pair_count <= COLOR_BASIC_PAIRS + 1)
+    {
+      fg = color_nearest(fg, 8);
+      bg = color_nearest(bg, 8);
+    }
+  if (fg < 8 && bg < 8)
+    return pair_of[id] = short(bg*8 + fg + 1);
+
+  int key = fg << 8 | bg;
+  auto found = pair_by_colors.find(key);
+  if (found != pair_by_colors.end())
+    {
+      pair_used[found->second] = rounds;
+      return pair_of[id] = found->second;
+    }
+
+  short pair;
+  if (pair_free < pair_count)
+    pair = short(pair_free++);
+  else
+    {
+      /* The least recently used pair changes its colors. Pairs used in
+       * this round are kept, cells already drawn with them would change */
+      pair = 0;
+      for (int i = COLOR_BASIC_PAIRS + 1; i < pair_count; ++i)
+        if (pair_used[i] != rounds && (!pair || pair_used[i] < pair_used[pair]))
+          pair = short(i);
+
+      /* All of them are on the screen: the closest basic colors for this round */
+      if (!pair)
+        return short(color_nearest(bg, 8)*8 + color_nearest(fg, 8) + 1);
+
+      pair_by_colors.erase(pair_colors[pair]);
+      for (short &p : pair_of)
+        if (p == pair)
+          p = 0;
+      ++evictions;
+    }
+
+  init_pair(pair, short(fg), short(bg));
+  pair_colors[pair] = key;
+  pair_used[pair] = rounds;
+  pair_by_colors.emplace(key, pair);
+  return pair_of[id] = pair;
+}
+
+short color_curses_pair(attr_t attribute)
+{
+  int id = PAIR_NUMBER(attribute);
+
+  if (id <= COLOR_BASIC_PAIRS)
+    return short(id);
+
+  short pair = pair_of[id];
+  if (!pair)
+    return pair_allocate(id);
+
+  pair_used[pair] = rounds;
+  return pair;
+}
+
+attr_t color_curses(attr_t attribute)
+{ return (attribute & ~A_COLOR) | attr_t(COLOR_PAIR(color_curses_pair(attribute))); }
+
+void color_tick()
+{ ++rounds; }
+
+unsigned color_evictions()
+{ return evictions; }
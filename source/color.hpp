@@ -0,0 +1,71 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef COLOR_HPP
+#define COLOR_HPP
+
+#include <cstdint>
+#include <ncurses.h>
+
+/* A color is an index of the 256-color palette or a COLOR_RGB value */
+#define COLOR_RGB(R, G, B) (0x1000000 | (R) << 16 | (G) << 8 | (B))
+
+/* Pairs of the 8 basic colors keep the ids PAIR() gives them,
+ * so they can be used in constants */
+#define COLOR_BASIC_PAIRS 64
+
+/* Read what the terminal can show. Called once after start_color() */
+void color_init();
+
+/* The attribute of the fg/bg combination. The same combination gives the
+ * same attribute. An attribute keeps 8 bits of a pair id, so past the first
+ * 191 combinations other than the basic ones a new combination gets the
+ * attribute of the closest one made */
+attr_t color_pair(int fg, int bg);
+
+/* The color of a YAML value: a basic color name, an index of the
+ * 256-color palette or #rrggbb. -1 if it is none of them */
+int color_parse(const char *value);
+
+/* Colors of the pair of an attribute, white on black without a pair */
+int color_fg(attr_t);
+int color_bg(attr_t);
+
+/* The terminal shows 24-bit colors */
+bool color_truecolor();
+
+/* RGB of the color, as xterm shows it */
+void color_rgb(int color, uint8_t rgb[3]);
+
+/* The color itself if it is one of the first colors of the palette,
+ * the closest of them otherwise */
+int color_nearest(int color, int colors);
+
+/* The curses pair of an attribute. Pairs are made on the first use and the
+ * least recently used ones are reused when the terminal runs out of them */
+short color_curses_pair(attr_t);
+
+/* The attribute with its curses pair, for wattron() and menus */
+attr_t color_curses(attr_t);
+
+/* Starts a new round of uses: pairs used in it are reused last */
+void color_tick();
+
+/* Grows each time a curses pair is reused. Cells drawn before it have
+ * changed their colors on the terminal */
+unsigned color_evictions();
+
+#endif // COLOR_HPP
@@ -0,0 +1,77 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "entity.hpp"
+
+entity_t entity_create(entity_store &s, int x, int y, int vision, uint16_t type, const cchar &symbol)
+{
+  entity_t e;
+  if (s.unused.empty())
+    {
+      e.index = uint32_t(s.dense.size());
+      s.dense.push_back(0);
+      s.generation.push_back(0);
+    }
+  else
+    {
+      e.index = s.unused.back();
+      s.unused.pop_back();
+    }
+  e.generation = s.generation[e.index];
+
+  s.dense[e.index] = uint32_t(s.handle.size());
+  s.x.push_back(x);
+  s.y.push_back(y);
+  s.vision.push_back(vision);
+  s.light.push_back(0);
+  s.shared.push_back(0);
+  s.type.push_back(type);
+  s.symbol.push_back(symbol);
+  s.handle.push_back(e);
+  return e;
+}
+
+template <class T>
+static void take_last(vector<T> &v, size_t i)
+{
+  v[i] = v.back();
+  v.pop_back();
+}
+
+void entity_destroy(entity_store &s, entity_t e)
+{
+  if (!entity_alive(s, e))
+    return;
+
+  size_t i = s.dense[e.index];
+  take_last(s.x, i);
+  take_last(s.y, i);
+  take_last(s.vision, i);
+  take_last(s.light, i);
+  take_last(s.shared, i);
+  take_last(s.type, i);
+  take_last(s.symbol, i);
+  take_last(s.handle, i);
+
+  if (i < s.handle.size())
+    s.dense[s.handle[i].index] = uint32_t(i);
+
+  ++s.generation[e.index];
+  s.unused.push_back(e.index);
+}
+
+bool entity_alive(const entity_store &s, entity_t e)
+{ return e.index < s.generation.size() && s.generation[e.index] == e.generation; }
@@ -0,0 +1,67 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENTITY_HPP
+#define ENTITY_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+
+using std::vector;
+
+/* Refers to an entity for as long as it lives, while its place in the
+ * arrays may change. The generation tells a destroyed entity from the
+ * one created later in its place */
+struct entity_t
+{
+  uint32_t index;
+  uint32_t generation;
+};
+
+/* The state of the entities that is read every turn, one array per
+ * field, so that a loop over one field reads contiguous memory.
+ * Destroying an entity moves the last one into its place */
+struct entity_store
+{
+  vector<int>      x;
+  vector<int>      y;
+  vector<int>      vision;
+  vector<int>      light;
+  vector<uint8_t>  shared;
+  vector<uint16_t> type;
+  vector<cchar>    symbol;
+  vector<entity_t> handle;
+
+  /* By the index of a handle: the place of its entity and the generation */
+  vector<uint32_t> dense;
+  vector<uint32_t> generation;
+  vector<uint32_t> unused;
+};
+
+entity_t entity_create(entity_store &s, int x, int y, int vision, uint16_t type, const cchar &symbol);
+void     entity_destroy(entity_store &s, entity_t e);
+bool     entity_alive(const entity_store &s, entity_t e);
+
+/* The place of a live entity in the arrays */
+inline size_t entity_at(const entity_store &s, entity_t e)
+{ return s.dense[e.index]; }
+
+inline size_t entity_count(const entity_store &s)
+{ return s.handle.size(); }
+
+#endif // ENTITY_HPP
@@ -30,9 +30,9 @@ static void parse_image_from_yaml        (const yaml_node_t *node, yaml_document
 static void parse_attribute_from_yaml    (const yaml_node_t *node, attr_t &attr);
 
 /* Dynamic alloc */
-event& event::create_from_yaml(const string &id, const yaml_node_t *node, yaml_document_t *doc)
+event& event::create_from_yaml(arena &a, const string &id, const yaml_node_t *node, yaml_document_t *doc)
 {
-  auto event = new class event(id);
+  auto event = &a.make<class event>(id);
 
   if (!node)
     throw game_error("Empty event structure.");
@@ -59,7 +59,11 @@ event& event::create_from_yaml(const string &id, const yaml_node_t *node, yaml_d
         parse_position_from_yaml(node_value, event->m_position);
 
       else if (!strcmp(YAML_EVENT_MESSAGE, key))
-        parse_string_from_yaml(node_value, event->m_message);
+        {
+          string message;
+          parse_string_from_yaml(node_value, message);
+          event->m_message = message;
+        }
 
       else if (!strcmp(YAML_EVENT_IMAGE, key))
         parse_image_from_yaml(node_value, doc, event->m_image);
@@ -76,13 +80,15 @@ event& event::create_from_yaml(const string &id, const yaml_node_t *node, yaml_d
         throw game_error( string("Invalid field in the event structure: \"") + key + "\"");
     }
 
-  constexpr int HOOKS_SIZE = 5;
+  constexpr int HOOKS_SIZE = 7;
   constexpr int HOOK_MENU = 1;
   event->m_event_hooks.reset(new hook[HOOKS_SIZE]
   {
     hook('\n',     {fun_t(window_menu_driver), REQ_EXEC_ITEM}), // HOOK_MENU
     hook(KEY_DOWN, {fun_t(window_menu_driver), REQ_DOWN_ITEM}),
     hook(KEY_UP,   {fun_t(window_menu_driver), REQ_UP_ITEM}),
+    hook(KEY_NPAGE, {fun_t(window_text_scroll),  1}),
+    hook(KEY_PPAGE, {fun_t(window_text_scroll), -1}),
     {0, {nullptr, 0}}
   }) ;
 
@@ -112,13 +118,13 @@ void event::run()
 {
   m_happened = true;
 
-  if (m_message.empty())
+  if (!m_message.lenght)
     scenario_parse_instructions(m_instructions);
   else
    {
       auto &&menu_build = builder(m_position, m_event_menu.get(), m_event_hooks.get(),
-                                  m_message, m_title, OPTION_NORMAL, FORMAT_CENTER,
-                                  &m_image, m_attribute);
+                                  &m_message, m_title, OPTION_NORMAL, FORMAT_CENTER,
+                                  &m_image, m_attribute, &m_layout);
       window_push(menu_build);
     }
 }
@@ -25,6 +25,7 @@
 #include "utils.hpp"
 #include "ui.hpp"
 #include "base.hpp"
+#include "arena.hpp"
 
 using std::unique_ptr;
 using std::string;
@@ -58,14 +59,16 @@ class event : public base
     event_instructions m_instructions;
     unique_ptr<item[]> m_event_menu = nullptr;
     unique_ptr<hook[]> m_event_hooks;
-    string             m_message;
+    text               m_message;
     attr_t             m_attribute = DEFAULT_EVENT_ATTRIBUTE;
     string             m_title;
     position           m_position  = DEFAULT_EVENT_SIZE;
     text               m_image;
+    text_layout        m_layout;
     bool               m_happened  = false;
     int                m_count     = 0;
 
+    friend class arena;
     event(const string &id) : base(id) {}
 
 public:
@@ -83,7 +86,7 @@ public:
     bool happened(int count = -1)
     { return count == -1? m_happened : m_happened * (m_count == count); }
 
-    static event& create_from_yaml(const string &id, const yaml_node_t *node, yaml_document_t *doc);
+    static event& create_from_yaml(arena &a, const string &id, const yaml_node_t *node, yaml_document_t *doc);
     static void selected(arg_t instructions_ptr);
 };
 
@@ -0,0 +1,380 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "fov.hpp"
+#include "parallel.hpp"
+
+/* Offsets of the column col of the row depth, by octants */
+static const int octant_xx[FOV_OCTANTS] = { 1,  0,  0, -1, -1,  0,  0,  1 };
+static const int octant_xy[FOV_OCTANTS] = { 0,  1, -1,  0,  0, -1,  1,  0 };
+static const int octant_yx[FOV_OCTANTS] = { 0,  1,  1,  0,  0, -1, -1,  0 };
+static const int octant_yy[FOV_OCTANTS] = { 1,  0,  0,  1, -1,  0,  0, -1 };
+
+/* Slopes are kept as fractions n/d with d > 0. In an octant they are never negative */
+struct slope
+{
+  int n;
+  int d;
+};
+
+/* The tiles in range of a radius */
+struct fov_shape
+{
+  tile_mask disc;
+  vector<tile_pos> tiles;
+
+  /* For a step east, south, west and north: tiles coming into range,
+   * from the new place, and going out of it, from the old one */
+  vector<tile_pos> enter[4];
+  vector<tile_pos> leave[4];
+
+  /* Offsets of the tiles of the octants by rows, the column col
+   * of the row depth is at depth * (depth + 1) / 2 + col */
+  vector<tile_pos> octants[FOV_OCTANTS];
+
+  /* The last column in range of each row */
+  vector<int> extent;
+};
+
+static const int step_x[4] = { 1, 0, -1,  0 };
+static const int step_y[4] = { 0, 1,  0, -1 };
+
+static const fov_shape &shape(int radius)
+{
+  static std::map<int, std::unique_ptr<fov_shape>> shapes;
+  static std::mutex mutex;
+
+  /* Viewers are updated in parallel */
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto &s = shapes[radius];
+  if (s)
+    return *s;
+
+  s.reset(new fov_shape);
+  s->disc.reset(-radius, -radius, radius * 2, radius * 2);
+
+  for (int dy = -radius; dy < radius; ++dy)
+    for (int dx = -radius; dx < radius; ++dx)
+      {
+        if (!fov_in_range(dx, dy, radius))
+          continue;
+
+        s->disc.set(dx, dy);
+        s->tiles.push_back({dx, dy});
+
+        for (int d = 0; d < 4; ++d)
+          {
+            if (!fov_in_range(dx + step_x[d], dy + step_y[d], radius))
+              s->enter[d].push_back({dx, dy});
+            if (!fov_in_range(dx - step_x[d], dy - step_y[d], radius))
+              s->leave[d].push_back({dx, dy});
+          }
+      }
+
+  s->extent.assign(size_t(std::max(radius, 1)), -1);
+  for (int o = 0; o < FOV_OCTANTS; ++o)
+    for (int depth = 0; depth < radius; ++depth)
+      for (int col = 0; col <= depth; ++col)
+        {
+          s->octants[o].push_back({col * octant_xx[o] + depth * octant_xy[o],
+                                   col * octant_yx[o] + depth * octant_yy[o]});
+          if (fov_in_range(col, depth, radius))
+            s->extent[size_t(depth)] = col;
+        }
+  return *s;
+}
+
+struct octant_scan
+{
+  int ox, oy, radius;
+  const fov_shape    &shape;
+  const tile_pos     *tiles;
+  const fov_opaque_f &opaque;
+  const fov_mark_f   &mark;
+
+  void scan(int depth, slope start, slope end) const;
+};
+
+/* The slope of the left edge of a tile */
+static inline slope tile_slope(int depth, int col)
+{ return slope{ 2 * col - 1, 2 * depth }; }
+
+void octant_scan::scan(int depth, slope start, slope end) const
+{
+  if (depth >= radius)
+    return;
+
+  /* Columns whose centers lie within the slopes, ties rounded inwards
+   * for the first one and outwards for the last one */
+  int first = (2 * depth * start.n + start.d) / (2 * start.d);
+  int last  = (2 * depth * end.n - end.d + 2 * end.d - 1) / (2 * end.d);
+
+  const tile_pos *row = tiles + depth * (depth + 1) / 2;
+  int extent = shape.extent[size_t(depth)];
+
+  int prev = -1; /* -1 none, 0 floor, 1 wall */
+  for (int col = first; col <= last; ++col)
+    {
+      int x = ox + row[col].x, y = oy + row[col].y;
+      bool is_wall = opaque(x, y);
+
+      /* Symmetric: the center of the tile is within the slopes */
+      bool centered = col * start.d >= depth * start.n && col * end.d <= depth * end.n;
+
+      if ((is_wall || centered) && col <= extent)
+        mark(x, y);
+
+      if (prev == 1 && !is_wall)
+        start = tile_slope(depth, col);
+
+      if (prev == 0 && is_wall)
+        scan(depth + 1, start, tile_slope(depth, col));
+
+      prev = is_wall;
+    }
+
+  if (prev == 0)
+    scan(depth + 1, start, end);
+}
+
+void fov_octant(int octant, int x, int y, int radius, const fov_opaque_f &opaque, const fov_mark_f &mark)
+{
+  const fov_shape &s = shape(radius);
+  octant_scan scan{ x, y, radius, s, s.octants[octant].data(), opaque, mark };
+
+  scan.scan(1, slope{ 0, 1 }, slope{ 1, 1 });
+}
+
+void fov_compute(int x, int y, int radius, const fov_opaque_f &opaque, const fov_mark_f &mark)
+{
+  if (radius < 1)
+    return;
+
+  mark(x, y);
+  for (int octant = 0; octant < FOV_OCTANTS; ++octant)
+    fov_octant(octant, x, y, radius, opaque, mark);
+}
+
+/* The scan of octant_scan toward the single tile (target, tcol) of an octant */
+struct los_scan
+{
+  int ox, oy;
+  int xx, xy, yx, yy;
+  int target, tcol;
+  const fov_opaque_f &opaque;
+
+  bool wall(int depth, int col) const
+  { return opaque(ox + col * xx + depth * xy, oy + col * yx + depth * yy); }
+
+  /* The target row has its column between the slopes */
+  bool reaches(slope start, slope end) const
+  {
+    return tcol >= (2 * target * start.n + start.d) / (2 * start.d) &&
+           tcol <= (2 * target * end.n - end.d + 2 * end.d - 1) / (2 * end.d);
+  }
+
+  bool scan(int depth, slope start, slope end) const;
+};
+
+bool los_scan::scan(int depth, slope start, slope end) const
+{
+  if (!reaches(start, end))
+    return false;
+
+  /* The same test octant_scan marks the tile with */
+  if (depth == target)
+    return wall(depth, tcol) ||
+           (tcol * start.d >= depth * start.n && tcol * end.d <= depth * end.n);
+
+  int first = (2 * depth * start.n + start.d) / (2 * start.d);
+  int last  = (2 * depth * end.n - end.d + 2 * end.d - 1) / (2 * end.d);
+
+  int prev = -1;
+  for (int col = first; col <= last; ++col)
+    {
+      bool is_wall = wall(depth, col);
+
+      if (prev == 1 && !is_wall)
+        start = tile_slope(depth, col);
+
+      if (prev == 0 && is_wall && scan(depth + 1, start, tile_slope(depth, col)))
+        return true;
+
+      prev = is_wall;
+    }
+
+  return prev == 0 && scan(depth + 1, start, end);
+}
+
+bool fov_los(int x0, int y0, int x1, int y1, const fov_opaque_f &opaque)
+{
+  int dx = x1 - x0, dy = y1 - y0;
+
+  if (!dx && !dy)
+    return true;
+
+  /* Tiles on the axes and the diagonals are in two octants */
+  for (int o = 0; o < FOV_OCTANTS; ++o)
+    {
+      int col   = dx * octant_xx[o] + dy * octant_yx[o];
+      int depth = dx * octant_xy[o] + dy * octant_yy[o];
+
+      if (col < 0 || col > depth)
+        continue;
+
+      los_scan scan{ x0, y0, octant_xx[o], octant_xy[o], octant_yx[o], octant_yy[o], depth, col, opaque };
+      if (scan.scan(1, slope{ 0, 1 }, slope{ 1, 1 }))
+        return true;
+    }
+  return false;
+}
+
+void fov_los(const vector<fov_line> &lines, vector<char> &seen, const fov_opaque_f &opaque)
+{
+  seen.resize(lines.size());
+  parallel_for(int(lines.size()), [&](int i) {
+      const fov_line &l = lines[size_t(i)];
+      seen[size_t(i)] = fov_los(l.x0, l.y0, l.x1, l.y1, opaque);
+    });
+}
+
+void fov_rays(int ox, int oy, int radius, const fov_opaque_f &opaque, const fov_mark_f &mark)
+{
+  for (int y = oy - radius; y < oy + radius; ++y)
+    for (int x = ox - radius; x < ox + radius; ++x)
+      {
+        if (!fov_in_range(x - ox, y - oy, radius)) continue;
+
+        int px = ox;
+        int py = oy;
+
+        int delta_x(x - px);
+
+        signed char const ix((delta_x > 0) - (delta_x < 0));
+        delta_x = std::abs(delta_x) << 1;
+
+        int delta_y(y - py);
+
+        signed char const iy((delta_y > 0) - (delta_y < 0));
+        delta_y = std::abs(delta_y) << 1;
+
+        mark(px, py);
+        if (opaque(px, py))
+          continue;
+
+        if (delta_x >= delta_y)
+          {
+            int error(delta_y - (delta_x >> 1));
+
+            while (px != x)
+              {
+                if ((error > 0) || (!error && (ix > 0)))
+                  {
+                    error -= delta_x;
+                    py += iy;
+                  }
+
+                error += delta_y;
+                px += ix;
+
+                mark(px, py);
+                if (opaque(px, py))
+                  break;
+              }
+          }
+        else
+          {
+            int error(delta_x - (delta_y >> 1));
+
+            while (py != y)
+              {
+                if ((error > 0) || (!error && (iy > 0)))
+                  {
+                    error -= delta_y;
+                    px += ix;
+                  }
+
+                error += delta_x;
+                py += iy;
+
+                mark(px, py);
+                if (opaque(px, py))
+                  break;
+              }
+          }
+      }
+}
+
+static int count_opaque(int x, int y, const vector<tile_pos> &tiles, const fov_opaque_f &opaque)
+{
+  int n = 0;
+  for (auto &t : tiles)
+    n += opaque(x + t.x, y + t.y);
+  return n;
+}
+
+bool fov_update(fov_cache &c, int x, int y, int radius, int width, int height,
+                const map_changes &changes, const fov_opaque_f &opaque)
+{
+  bool changed = false;
+  /* A cache behind the trimmed changes is a new one, it is computed anyway */
+  for (size_t i = std::max(c.changes, changes.first); i < changes.end(); ++i)
+    changed |= fov_in_range(changes[i].x - c.x, changes[i].y - c.y, c.radius);
+  c.changes = changes.end();
+
+  if (c.valid && !changed && c.radius == radius && c.x == x && c.y == y)
+    return false;
+
+  const fov_shape &s = shape(radius);
+
+  /* A step: only the edges of the range are new */
+  int step = -1;
+  for (int d = 0; d < 4; ++d)
+    if (x - c.x == step_x[d] && y - c.y == step_y[d])
+      step = d;
+
+  if (c.valid && !changed && c.radius == radius && step >= 0)
+    c.opaque += count_opaque(x, y, s.enter[step], opaque) - count_opaque(c.x, c.y, s.leave[step], opaque);
+  else
+    c.opaque = count_opaque(x, y, s.tiles, opaque);
+
+  c.x = x;
+  c.y = y;
+  c.radius = radius;
+  c.valid = true;
+
+  /* Nothing blocks the sight: the whole range is seen */
+  if (!c.opaque && x >= radius && y >= radius && x + radius <= width && y + radius <= height)
+    {
+      c.visible = s.disc;
+      c.visible.move_to(x - radius, y - radius);
+      return true;
+    }
+
+  c.visible.reset(x - radius, y - radius, radius * 2, radius * 2);
+  fov_compute(x, y, radius, opaque, [&](int tx, int ty) {
+      if (tx >= 0 && ty >= 0 && tx < width && ty < height)
+        c.visible.set(tx, ty);
+    });
+  return true;
+}
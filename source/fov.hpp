@@ -0,0 +1,82 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef FOV_HPP
+#define FOV_HPP
+
+#include <functional>
+
+#include "map.hpp"
+
+/* Tells if the tile (x, y) blocks the sight */
+typedef std::function<bool(int x, int y)> fov_opaque_f;
+
+/* Called for the tiles seen, some of them more than once */
+typedef std::function<void(int x, int y)> fov_mark_f;
+
+/* Octants are the sectors between the axes and the diagonals */
+#define FOV_OCTANTS 8
+
+/* The tile at (dx, dy) from the viewer is within the radius */
+inline bool fov_in_range(int dx, int dy, int radius)
+{ return dx * dx + dy * dy <= radius * radius - radius; }
+
+/* Symmetric shadowcasting over one octant of the field of view from (x, y).
+ * A floor tile is seen when its center is seen, and then the viewer can be
+ * seen from it. Walls are seen when any part of them is seen */
+void fov_octant(int octant, int x, int y, int radius, const fov_opaque_f &opaque, const fov_mark_f &mark);
+
+/* The whole field of view, the viewer's tile included */
+void fov_compute(int x, int y, int radius, const fov_opaque_f &opaque, const fov_mark_f &mark);
+
+/* Whether (x1, y1) is seen from (x0, y0) at any range. The answer is the one
+ * fov_compute gives, found by scanning only the rows up to the target and
+ * the parts of them the target can still be seen through */
+bool fov_los(int x0, int y0, int x1, int y1, const fov_opaque_f &opaque);
+
+struct fov_line
+{
+  int x0, y0;
+  int x1, y1;
+};
+
+/* Many lines of sight at once, on several threads: seen[i] is set to the answer for lines[i] */
+void fov_los(const vector<fov_line> &lines, vector<char> &seen, const fov_opaque_f &opaque);
+
+/* The former field of view: a Bresenham line from the viewer to every tile
+ * in range. Kept to compare the results with */
+void fov_rays(int x, int y, int radius, const fov_opaque_f &opaque, const fov_mark_f &mark);
+
+/* The field of view of one viewer, kept between turns */
+struct fov_cache
+{
+  int    x       = 0;
+  int    y       = 0;
+  int    radius  = 0;
+  bool   valid   = false;
+  size_t changes = 0;  /* map changes already looked at */
+  int    opaque  = 0;  /* opaque tiles in range */
+  tile_mask visible;   /* tiles seen on the map */
+};
+
+/* Bring the cache to the viewer at (x, y) on a width x height map.
+ * changes are the tiles changed on the map so far. The field of view is
+ * computed again only when the viewer has moved or a changed tile is in
+ * range; returns false when the cache was still right */
+bool fov_update(fov_cache &c, int x, int y, int radius, int width, int height,
+                const map_changes &changes, const fov_opaque_f &opaque);
+
+#endif // FOV_HPP
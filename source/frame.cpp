@@ -0,0 +1,384 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <utility>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+
+#include "frame.hpp"
+#include "color.hpp"
+
+using std::string;
+
+/* Unchanged cells between two changed runs that are cheaper
+ * to rewrite than to start a new run for */
+#define FRAME_RUN_GAP 4
+
+void cell_wide(cell_t c, cchar_t *out)
+{
+  wchar_t wch[2] = { wchar_t(glyph_code(glyph_t(cell_symbol(c)))), L'\0' };
+  attr_t attribute = cell_attribute(c);
+
+  setcchar(out, wch, attribute & ~A_COLOR, color_curses_pair(attribute), nullptr);
+}
+
+void frame_resize(struct frame *f, int lines, int cols)
+{
+  if (f->lines == lines && f->cols == cols)
+    return;
+
+  f->lines = lines;
+  f->cols  = cols;
+  f->front.assign(size_t(lines) * size_t(cols), 0);
+  f->back.assign(size_t(lines) * size_t(cols), 0);
+  f->invalid = true;
+  f->scroll_y = f->scroll_x = 0;
+  f->partial = false;
+  f->touched.clear();
+}
+
+void frame_invalidate(struct frame *f)
+{ f->invalid = true; }
+
+void frame_restore(struct frame *f)
+{
+  f->back = f->front;
+  f->invalid = true;
+  f->scroll_y = f->scroll_x = 0;
+  f->partial = false;
+  f->touched.clear();
+}
+
+void frame_compose(struct frame *f, const vector<text> &m, int x, int y)
+{
+  f->partial = false;
+  f->touched.clear();
+
+  int h = int(m.size());
+  int w = m.empty() ? 0 : int(m.front().lenght);
+
+  for (int i = 0; i < f->lines; ++i)
+    {
+      const struct cchar *line = y + i < h ? m[size_t(y + i)].cstr : nullptr;
+      cell_t *row = frame_row(f, i);
+
+      for (int j = 0; j < f->cols; ++j)
+        {
+          row[j] = line && x + j < w ? cchar_cell(&line[x + j]) : cell_pack(' ', A_NORMAL);
+
+          /* A wide glyph covers the next cell, or does not fit at the edge */
+          if (glyph_width(glyph_t(cell_symbol(row[j]))) == 2)
+            {
+              if (j + 1 < f->cols)
+                {
+                  row[j + 1] = cell_pack(GLYPH_WIDE_TAIL, cell_attribute(row[j]));
+                  ++j;
+                }
+              else
+                row[j] = cell_pack(' ', cell_attribute(row[j]));
+            }
+        }
+    }
+}
+
+void frame_touch(struct frame *f, int line, int col, cell_t c)
+{
+  int i = line * f->cols + col;
+
+  f->back[size_t(i)] = c;
+  f->touched.push_back(i);
+  f->partial = true;
+}
+
+bool frame_scroll(struct frame *f, int dy, int dx)
+{
+  if (f->invalid || f->scroll_y || f->scroll_x || std::abs(dy) + std::abs(dx) != 1)
+    return false;
+
+  const cell_t blank = cell_pack(' ', A_NORMAL);
+  size_t cols = size_t(f->cols);
+  cell_t *front = f->front.data();
+
+  /* Move the front buffer the same way the terminal will move */
+  if (dy > 0)
+    {
+      std::move(front + cols, front + f->front.size(), front);
+      std::fill(front + f->front.size() - cols, front + f->front.size(), blank);
+    }
+  else if (dy < 0)
+    {
+      std::move_backward(front, front + f->front.size() - cols, front + f->front.size());
+      std::fill(front, front + cols, blank);
+    }
+  else for (int i = 0; i < f->lines; ++i)
+    {
+      cell_t *row = front + size_t(i) * cols;
+      if (dx > 0)
+        {
+          std::move(row + 1, row + cols, row);
+          row[cols - 1] = blank;
+        }
+      else
+        {
+          std::move_backward(row, row + cols - 1, row + cols);
+          row[0] = blank;
+        }
+    }
+
+  f->scroll_y = dy;
+  f->scroll_x = dx;
+  return true;
+}
+
+static int frame_draw(struct frame *f, WINDOW *w)
+{
+  static vector<cchar_t> run;
+  run.resize(size_t(f->cols));
+
+  int rc = OK;
+
+  if (f->scroll_y)
+    {
+      idlok(w, TRUE);
+      scrollok(w, TRUE);
+      rc = wscrl(w, f->scroll_y);
+      scrollok(w, FALSE);
+    }
+  else if (f->scroll_x) for (int i = 0; i < f->lines; ++i)
+    {
+      if (f->scroll_x > 0)
+        rc = mvwdelch(w, i, 0);
+      else
+        rc = mvwinsch(w, i, 0, ' ');
+    }
+  f->scroll_y = f->scroll_x = 0;
+
+  if (f->partial && !f->invalid)
+    {
+      for (int i : f->touched)
+        if (f->back[size_t(i)] != f->front[size_t(i)])
+          {
+            cchar_t wide;
+            cell_wide(f->front[size_t(i)] = f->back[size_t(i)], &wide);
+            if (cell_symbol(f->front[size_t(i)]) != GLYPH_WIDE_TAIL)
+              rc = mvwadd_wch(w, i / f->cols, i % f->cols, &wide);
+          }
+
+      f->partial = false;
+      f->touched.clear();
+      return rc;
+    }
+
+  for (int i = 0; i < f->lines; ++i)
+    {
+      const cell_t *back  = f->back.data()  + size_t(i) * size_t(f->cols);
+      cell_t       *front = f->front.data() + size_t(i) * size_t(f->cols);
+
+      for (int j = 0; j < f->cols; ++j)
+        {
+          if (!f->invalid && back[j] == front[j])
+            continue;
+
+          /* Extend the run while the cells differ or the gap is short */
+          int begin = j, end = j + 1;
+          for (int k = end; k < f->cols && k - end < FRAME_RUN_GAP; ++k)
+            if (f->invalid || back[k] != front[k])
+              end = k + 1;
+
+          /* Curses fills the right half of a wide glyph by itself */
+          int n = 0;
+          for (int k = begin; k < end; ++k)
+            if (cell_symbol(back[k]) != GLYPH_WIDE_TAIL)
+              cell_wide(back[k], &run[size_t(n++)]);
+
+          rc = mvwadd_wchnstr(w, i, begin, run.data(), n);
+          std::copy(back + begin, back + end, front + begin);
+          j = end - 1;
+        }
+    }
+
+  f->partial = false;
+  f->touched.clear();
+  f->invalid = false;
+  return rc;
+}
+
+int frame_flush(struct frame *f, WINDOW *w)
+{
+  color_tick();
+  unsigned evictions = color_evictions();
+
+  int rc = frame_draw(f, w);
+
+  /* Pairs the frame was drawn with got other colors, draw it with the new ones */
+  if (evictions != color_evictions())
+    {
+      f->invalid = true;
+      rc = frame_draw(f, w);
+    }
+  return rc;
+}
+
+/* The SGR parameters of a color, base is 30 for the foreground and 40 for the background */
+static void ansi_color(string &out, int color, int base)
+{
+  char buf[32];
+  uint8_t rgb[3];
+
+  if (color >= 256 && color_truecolor())
+    {
+      color_rgb(color, rgb);
+      out += (snprintf(buf, sizeof(buf), ";%d;2;%d;%d;%d", base + 8, rgb[0], rgb[1], rgb[2]), buf);
+      return;
+    }
+
+  color = color_nearest(color, COLORS < 256 ? COLORS : 256);
+  if (color < 8)
+    out += (snprintf(buf, sizeof(buf), ";%d", base + color), buf);
+  else if (color < 16)
+    out += (snprintf(buf, sizeof(buf), ";%d", base + 60 + color - 8), buf);
+  else
+    out += (snprintf(buf, sizeof(buf), ";%d;5;%d", base + 8, color), buf);
+}
+
+/* SGR sequence selecting the attributes and the colors of the pair */
+static void ansi_sgr(string &out, attr_t attribute)
+{
+  out += "\033[0";
+
+  if (attribute & A_BOLD)      out += ";1";
+  if (attribute & A_DIM)       out += ";2";
+  if (attribute & A_UNDERLINE) out += ";4";
+  if (attribute & A_BLINK)     out += ";5";
+  if (attribute & A_REVERSE)   out += ";7";
+
+  if (PAIR_NUMBER(attribute))
+    {
+      ansi_color(out, color_fg(attribute), 30);
+      ansi_color(out, color_bg(attribute), 40);
+    }
+
+  out += 'm';
+}
+
+int frame_flush_ansi(struct frame *f, int y, int x)
+{
+  static string out;
+  out.clear();
+
+  /* Keep the cursor and the attributes ncurses believes in */
+  out += "\0337";
+
+  int    cy = -1, cx = -1;
+  attr_t current = attr_t(-1);
+  char   buf[64];
+  bool   scrolled = f->scroll_y || f->scroll_x;
+
+  /* The frame is the only thing on its lines and has empty columns
+   * on both sides, so whole lines of the scroll region may move */
+  if (f->scroll_y)
+    {
+      out += (snprintf(buf, sizeof(buf), "\033[0m\033[%d;%dr", y + 1, y + f->lines), buf);
+      if (f->scroll_y > 0)
+        out += (snprintf(buf, sizeof(buf), "\033[%d;1H\033D", y + f->lines), buf);
+      else
+        out += (snprintf(buf, sizeof(buf), "\033[%d;1H\033M", y + 1), buf);
+      out += "\033[r";
+    }
+  else if (f->scroll_x) for (int i = 0; i < f->lines; ++i)
+    {
+      /* Deleting a cell pulls the empty column on the right into the frame.
+       * Before inserting one, the last cell is deleted, so nothing
+       * is pushed out of the frame */
+      if (f->scroll_x > 0)
+        out += (snprintf(buf, sizeof(buf), "\033[0m\033[%d;%dH\033[P", y + i + 1, x + 1), buf);
+      else
+        out += (snprintf(buf, sizeof(buf), "\033[0m\033[%d;%dH\033[P\033[%dG\033[@",
+                         y + i + 1, x + f->cols, x + 1), buf);
+    }
+  f->scroll_y = f->scroll_x = 0;
+
+  /* Write the cell (i, j) of the back buffer */
+  auto put = [&](int i, int j) {
+      cell_t c = f->front[size_t(i * f->cols + j)] = f->back[size_t(i * f->cols + j)];
+
+      /* The terminal has moved past the right half of a wide glyph */
+      if (cell_symbol(c) == GLYPH_WIDE_TAIL)
+        {
+          if (cy == i && cx == j)
+            ++cx;
+          return;
+        }
+
+      if (cy != i)
+        out += (snprintf(buf, sizeof(buf), "\033[%d;%dH", y + i + 1, x + j + 1), buf);
+      else if (cx != j)
+        out += (snprintf(buf, sizeof(buf), "\033[%dC", j - cx), buf);
+
+      attr_t attribute = cell_attribute(c);
+      if (attribute != current)
+        {
+          ansi_sgr(out, attribute);
+          current = attribute;
+        }
+
+      char utf8[4];
+      out.append(utf8, glyph_utf8(glyph_t(cell_symbol(c)), utf8));
+      cy = i;
+      cx = j + 1;
+    };
+
+  if (f->partial && !f->invalid)
+    {
+      for (int i : f->touched)
+        if (f->back[size_t(i)] != f->front[size_t(i)])
+          put(i / f->cols, i % f->cols);
+    }
+  else for (int i = 0; i < f->lines; ++i)
+    {
+      const cell_t *back  = f->back.data()  + size_t(i) * size_t(f->cols);
+      const cell_t *front = f->front.data() + size_t(i) * size_t(f->cols);
+
+      for (int j = 0; j < f->cols; ++j)
+        if (f->invalid || back[j] != front[j])
+          put(i, j);
+    }
+
+  out += "\0338";
+
+  f->partial = false;
+  f->touched.clear();
+  f->invalid = false;
+
+  /* Nothing changed */
+  if (cy == -1 && !scrolled)
+    return OK;
+
+  for (size_t done = 0; done < out.size(); )
+    {
+      ssize_t n = write(STDOUT_FILENO, out.data() + done, out.size() - done);
+      if (n < 0 && errno != EINTR)
+        return ERR;
+      if (n > 0)
+        done += size_t(n);
+    }
+  return OK;
+}
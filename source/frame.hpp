@@ -0,0 +1,103 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <ncurses.h>
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+
+using std::vector;
+
+/* Packed screen cell: attributes in the high half, glyph in the low half */
+typedef uint64_t cell_t;
+
+inline cell_t cell_pack(unsigned symbol, attr_t attribute)
+{ return cell_t(attribute) << 32 | symbol; }
+
+inline unsigned cell_symbol(cell_t c)
+{ return unsigned(c & 0xffffffff); }
+
+inline attr_t cell_attribute(cell_t c)
+{ return attr_t(c >> 32); }
+
+/* Symbol and attributes merged into one cell */
+inline cell_t cchar_cell(const struct cchar *t)
+{
+  if (t->attribute & A_INVIS)
+    return cell_pack(' ', A_NORMAL);
+
+  return cell_pack(t->symbol, t->attribute);
+}
+
+/* Double-buffered cells of a window: the back buffer is composed,
+ * the front buffer holds what the window shows now */
+struct frame
+{
+  int lines = 0;
+  int cols  = 0;
+  vector<cell_t> front;
+  vector<cell_t> back;
+
+  /* The front buffer is unknown, the next flush writes everything */
+  bool invalid = true;
+
+  /* Shift of the content the next flush makes on the terminal */
+  int scroll_y = 0;
+  int scroll_x = 0;
+
+  /* Only the touched cells of the back buffer are new,
+   * the next flush does not look at the others */
+  bool partial = false;
+  vector<int> touched;
+};
+
+void frame_resize(struct frame *, int lines, int cols);
+void frame_invalidate(struct frame *);
+
+inline cell_t *frame_row(struct frame *f, int line)
+{ return f->back.data() + size_t(line) * size_t(f->cols); }
+
+/* The wide character of the cell for the curses output */
+void cell_wide(cell_t c, cchar_t *out);
+
+/* Fill the back buffer from m starting with the cell (x, y) */
+void frame_compose(struct frame *, const vector<text> &m, int x, int y);
+
+/* Change one cell of the back buffer, which is otherwise what is shown */
+void frame_touch(struct frame *, int line, int col, cell_t c);
+
+/* Make the next flush write the front buffer again */
+void frame_restore(struct frame *);
+
+/* The content moved by one cell: the next flush scrolls the terminal
+ * and then writes only the uncovered edge and the changed cells.
+ * Returns false if the shift can not be done by scrolling. */
+bool frame_scroll(struct frame *, int dy, int dx);
+
+/* Write only the runs that differ from the front buffer and swap buffers */
+int frame_flush(struct frame *, WINDOW *w);
+
+/* The same, but the runs are written straight to the terminal as VT/ANSI
+ * escape sequences with a single write(), bypassing ncurses.
+ * y and x are the screen position of the frame. */
+int frame_flush_ansi(struct frame *, int y, int x);
+
+#endif // FRAME_HPP
@@ -0,0 +1,171 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <unordered_map>
+#include <cwchar>
+
+#include "glyph.hpp"
+#include "utils.hpp"
+
+#define GLYPH_ASCII     0x80
+#define GLYPH_MAX       0x10000
+#define GLYPH_REPLACING 0xfffd
+
+/* Code points by glyphs. The table only grows, so a glyph can be read
+ * by the painter thread while the game is interning new ones. Glyphs
+ * are interned without a lock: only the game thread may decode */
+static uint32_t glyph_codes[GLYPH_MAX];
+static uint8_t  glyph_widths[GLYPH_MAX];
+static glyph_t  glyph_next = GLYPH_ASCII;
+static std::unordered_map<uint32_t, glyph_t> glyph_ids;
+
+static glyph_t glyph_intern(uint32_t code)
+{
+  if (code < GLYPH_ASCII)
+    return glyph_t(code);
+
+  auto found = glyph_ids.find(code);
+  if (found != glyph_ids.end())
+    return found->second;
+
+  if (glyph_next == GLYPH_MAX - 1)
+    throw game_error("Too many different symbols.");
+
+  glyph_codes[glyph_next] = code;
+  glyph_ids.emplace(code, glyph_next);
+  return glyph_next++;
+}
+
+/* The length of the sequence by its first byte, 0 if it cannot start one */
+static size_t utf8_length(unsigned char c)
+{
+  if (c < 0x80)           return 1;
+  if ((c & 0xe0) == 0xc0) return 2;
+  if ((c & 0xf0) == 0xe0) return 3;
+  if ((c & 0xf8) == 0xf0) return 4;
+  return 0;
+}
+
+glyph_t glyph_decode(const char *s, size_t *n)
+{
+  auto c = static_cast<unsigned char>(s[0]);
+  size_t len = utf8_length(c);
+
+  *n = 1;
+  if (len == 1)
+    return glyph_t(c);
+  if (len == 0)
+    return glyph_intern(GLYPH_REPLACING);
+
+  uint32_t code = c & (0x7f >> len);
+  for (size_t i = 1; i < len; ++i)
+    {
+      auto b = static_cast<unsigned char>(s[i]);
+      if ((b & 0xc0) != 0x80)
+        return glyph_intern(GLYPH_REPLACING);
+      code = code << 6 | (b & 0x3f);
+    }
+
+  *n = len;
+  return glyph_intern(code);
+}
+
+std::vector<glyph_t> glyph_string(const std::string &s)
+{
+  std::vector<glyph_t> glyphs;
+  glyphs.reserve(s.size());
+
+  for (size_t i = 0, n; i < s.size(); i += n)
+    glyphs.push_back(glyph_decode(s.c_str() + i, &n));
+
+  return glyphs;
+}
+
+glyph_set glyph_set_of(const std::string &s)
+{
+  glyph_set set;
+
+  for (glyph_t g : glyph_string(s))
+    if (g < 256)
+      set.bits[g >> 6] |= uint64_t(1) << (g & 63);
+    else
+      set.others.push_back(g);
+
+  return set;
+}
+
+size_t glyph_count(const char *s, size_t n)
+{
+  size_t count = 0;
+
+  /* The same steps glyph_decode makes */
+  for (size_t i = 0; i < n; ++count)
+    {
+      size_t len = utf8_length(static_cast<unsigned char>(s[i]));
+      size_t k = 1;
+
+      while (k < len && i + k < n && (static_cast<unsigned char>(s[i + k]) & 0xc0) == 0x80)
+        ++k;
+
+      i += k == len ? len : 1;
+    }
+
+  return count;
+}
+
+uint32_t glyph_code(glyph_t g)
+{ return g < GLYPH_ASCII ? g : glyph_codes[g]; }
+
+size_t glyph_utf8(glyph_t g, char *out)
+{
+  uint32_t code = glyph_code(g);
+
+  if (code < 0x80)
+    {
+      out[0] = char(code);
+      return 1;
+    }
+  if (code < 0x800)
+    {
+      out[0] = char(0xc0 | code >> 6);
+      out[1] = char(0x80 | (code & 0x3f));
+      return 2;
+    }
+  if (code < 0x10000)
+    {
+      out[0] = char(0xe0 | code >> 12);
+      out[1] = char(0x80 | (code >> 6 & 0x3f));
+      out[2] = char(0x80 | (code & 0x3f));
+      return 3;
+    }
+
+  out[0] = char(0xf0 | code >> 18);
+  out[1] = char(0x80 | (code >> 12 & 0x3f));
+  out[2] = char(0x80 | (code >> 6 & 0x3f));
+  out[3] = char(0x80 | (code & 0x3f));
+  return 4;
+}
+
+int glyph_width(glyph_t g)
+{
+  if (g < GLYPH_ASCII)
+    return 1;
+
+  /* Asked for every cell of the view, so wcwidth is called once per glyph */
+  if (!glyph_widths[g])
+    glyph_widths[g] = wcwidth(wchar_t(glyph_codes[g])) == 2 ? 2 : 1;
+  return glyph_widths[g];
+}
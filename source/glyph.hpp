@@ -0,0 +1,73 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GLYPH_HPP
+#define GLYPH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Index into the table of the symbols met so far. ASCII symbols are their
+ * own glyphs, any other Unicode symbol is given the next free id */
+typedef uint16_t glyph_t;
+
+/* The right half of a glyph two columns wide: nothing is drawn there */
+constexpr glyph_t GLYPH_WIDE_TAIL = 0;
+
+/* The glyph of the UTF-8 sequence at s, *n is set to its length in bytes.
+ * Broken sequences give U+FFFD */
+glyph_t glyph_decode(const char *s, size_t *n);
+
+/* The glyphs of a UTF-8 string */
+std::vector<glyph_t> glyph_string(const std::string &s);
+
+/* The count of glyphs in a UTF-8 string */
+size_t glyph_count(const char *s, size_t n);
+
+uint32_t glyph_code(glyph_t);
+
+/* UTF-8 bytes of the glyph, returns their count (up to 4) */
+size_t glyph_utf8(glyph_t, char *out);
+
+/* Columns the glyph takes on the terminal, 1 or 2 */
+int glyph_width(glyph_t);
+
+/* A set of glyphs: one bit for each glyph the tile palette covers,
+ * a list for the others */
+struct glyph_set
+{
+  uint64_t bits[4] = {};
+  std::vector<glyph_t> others;
+};
+
+/* The set of the glyphs of a UTF-8 string */
+glyph_set glyph_set_of(const std::string &s);
+
+inline bool glyph_in(const glyph_set &set, glyph_t g)
+{
+  if (g < 256)
+    return set.bits[g >> 6] >> (g & 63) & 1;
+
+  for (glyph_t other : set.others)
+    if (other == g)
+      return true;
+  return false;
+}
+
+#endif // GLYPH_HPP
@@ -0,0 +1,219 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <chrono>
+
+#include "headless.hpp"
+#include "window.hpp"
+#include "scene.hpp"
+
+/* Only front is used: every print is a complete frame */
+static struct frame view_frame;
+
+static const struct
+{
+  const char *name;
+  void      (*move)(arg_t);
+  arg_t       arg;
+}
+commands[] =
+{
+  { "left",       scenario_move_player_x, arg_t(-1) },
+  { "right",      scenario_move_player_x, arg_t(1)  },
+  { "up",         scenario_move_player_y, arg_t(-1) },
+  { "down",       scenario_move_player_y, arg_t(1)  },
+  { "view-left",  scenario_move_view_x,   arg_t(-1) },
+  { "view-right", scenario_move_view_x,   arg_t(1)  },
+  { "view-up",    scenario_move_view_y,   arg_t(-1) },
+  { "view-down",  scenario_move_view_y,   arg_t(1)  },
+  { "tick",       scenario_animate,       arg_t(0)  },
+};
+
+/* Keys for the windows events open */
+static const struct
+{
+  const char *name;
+  int         key;
+}
+keys[] =
+{
+  { "enter", '\n'     },
+  { "next",  KEY_DOWN },
+  { "prev",  KEY_UP   },
+};
+
+void headless_print(const vector<text> &m, int x, int y, int view_x, int view_y,
+                    const vector<int> *cells)
+{
+  (void) view_x;
+  (void) view_y;
+
+  if (!cells)
+    {
+      frame_compose(&view_frame, m, x, y);
+      view_frame.front.swap(view_frame.back);
+      return;
+    }
+
+  int w = int(m.front().lenght);
+  for (int c : *cells)
+    {
+      int line = c / w - y, col = c % w - x;
+      if (line >= 0 && col >= 0 && line < view_frame.lines && col < view_frame.cols)
+        view_frame.front[size_t(line * view_frame.cols + col)] =
+            cchar_cell(&m[size_t(c / w)].cstr[c % w]);
+    }
+}
+
+void headless_resize(int lines, int cols)
+{ frame_resize(&view_frame, lines, cols); }
+
+const vector<cell_t> &headless_snapshot()
+{ return view_frame.front; }
+
+/* FNV-1a over the packed cells */
+uint64_t headless_hash()
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (cell_t c : view_frame.front)
+    for (int i = 0; i < 8; ++i, c >>= 8)
+      {
+        hash ^= c & 0xff;
+        hash *= 1099511628211ULL;
+      }
+
+  return hash;
+}
+
+string headless_dump()
+{
+  string s;
+  s.reserve(view_frame.front.size() + size_t(view_frame.lines));
+
+  for (int i = 0; i < view_frame.lines; ++i)
+    {
+      const cell_t *row = view_frame.front.data() + size_t(i) * size_t(view_frame.cols);
+
+      for (int j = 0; j < view_frame.cols; ++j)
+        if (cell_symbol(row[j]) != GLYPH_WIDE_TAIL)
+          {
+            char utf8[4];
+            s.append(utf8, glyph_utf8(glyph_t(cell_symbol(row[j])), utf8));
+          }
+
+      s += '\n';
+    }
+
+  return s;
+}
+
+long headless_compare(const vector<cell_t> &snapshot)
+{
+  if (snapshot.size() != view_frame.front.size())
+    return -1;
+
+  long count = 0;
+  for (size_t i = 0; i < snapshot.size(); ++i)
+    count += snapshot[i] != view_frame.front[i];
+
+  return count;
+}
+
+static bool run_command(const char *name)
+{
+  for (const auto &c : commands)
+    if (!strcmp(name, c.name))
+      {
+        c.move(c.arg);
+        return true;
+      }
+
+  for (const auto &k : keys)
+    if (!strcmp(name, k.name))
+      {
+        if (window_top())
+          {
+            ungetch(k.key);
+            window_hook();
+          }
+        return true;
+      }
+
+  return false;
+}
+
+int headless_run(const string &f, int lines, int cols, FILE *in, FILE *out)
+{
+  /* Events still open their windows: give them a screen nobody sees */
+  FILE *null_out = fopen("/dev/null", "w");
+  FILE *null_in  = fopen("/dev/null", "r");
+  if (!null_out || !null_in || !newterm("vt100", null_out, null_in))
+    {
+      fprintf(stderr, "Cannot open a screen for the headless run.\n");
+      return EXIT_FAILURE;
+    }
+
+  int status = EXIT_SUCCESS;
+  headless_resize(lines, cols);
+
+  try {
+    scenario_create_from_config(f, headless_print, lines, cols);
+    scenario_render();
+    fprintf(out, "render %016llx\n", static_cast<unsigned long long>(headless_hash()));
+
+    char name[32];
+    while (fscanf(in, "%31s", name) == 1)
+      {
+        if (!strcmp(name, "dump"))
+          {
+            fputs(headless_dump().c_str(), out);
+            continue;
+          }
+        if (!strcmp(name, "fov-compare"))
+          {
+            fputs(scenario_fov_compare().c_str(), out);
+            continue;
+          }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!run_command(name))
+          {
+            fprintf(stderr, "Unknown command \"%s\".\n", name);
+            status = EXIT_FAILURE;
+            break;
+          }
+        auto end = std::chrono::steady_clock::now();
+
+        fprintf(out, "%s %016llx %lldus\n", name,
+                static_cast<unsigned long long>(headless_hash()),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+      }
+
+  } catch (const game_error &error) {
+    fprintf(stderr, "%s\n", error.what());
+    status = EXIT_FAILURE;
+  }
+
+  while (window_top())
+    window_pop();
+  endwin();
+  fclose(null_out);
+  fclose(null_in);
+
+  return status;
+}
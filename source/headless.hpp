@@ -0,0 +1,45 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <cstdio>
+#include <string>
+
+#include "frame.hpp"
+
+using std::string;
+
+/* The game view kept in memory: a render_f that needs no terminal */
+void headless_print(const vector<text> &m, int x, int y, int view_x, int view_y,
+                    const vector<int> *cells);
+void headless_resize(int lines, int cols);
+
+/* The last printed view */
+const vector<cell_t> &headless_snapshot();
+uint64_t headless_hash();
+string headless_dump();
+
+/* The count of cells differing from the snapshot, -1 on another size */
+long headless_compare(const vector<cell_t> &snapshot);
+
+/* Play the scenario f in a lines x cols view with the commands read from in.
+ * The hash of the view is written to out after each command */
+int headless_run(const string &f, int lines, int cols, FILE *in, FILE *out);
+
+#endif // HEADLESS_HPP
@@ -0,0 +1,94 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "light.hpp"
+#include "parallel.hpp"
+
+void light_reset(light_map &m, int width, int height)
+{
+  m.width = width;
+  m.height = height;
+  m.levels.assign(size_t(width) * size_t(height), 0);
+  m.sources.clear();
+  m.unused.clear();
+}
+
+size_t light_add(light_map &m, int x, int y, int radius)
+{
+  size_t i = m.sources.size();
+  if (m.unused.empty())
+    m.sources.emplace_back();
+  else
+    {
+      i = m.unused.back();
+      m.unused.pop_back();
+    }
+
+  /* The tiles of a removed light may be counted yet, lit keeps them */
+  light_source &s = m.sources[i];
+  s.x = x;
+  s.y = y;
+  s.radius = radius;
+  s.fov.valid = false;
+  return i;
+}
+
+void light_move(light_map &m, size_t i, int x, int y)
+{
+  m.sources[i].x = x;
+  m.sources[i].y = y;
+}
+
+void light_remove(light_map &m, size_t i)
+{
+  m.sources[i].radius = 0;
+  m.sources[i].fov.valid = false;
+  m.unused.push_back(i);
+}
+
+bool light_update(light_map &m, const map_changes &changes, const fov_opaque_f &opaque)
+{
+  size_t n = m.sources.size();
+  vector<char> changed(n);
+
+  parallel_for(int(n), [&](int i) {
+      light_source &s = m.sources[size_t(i)];
+
+      if (s.radius > 0)
+        changed[size_t(i)] = fov_update(s.fov, s.x, s.y, s.radius, m.width, m.height, changes, opaque);
+      else
+        changed[size_t(i)] = s.lit.width() > 0;
+    });
+
+  bool updated = false;
+  for (size_t i = 0; i < n; ++i)
+    if (changed[i])
+      {
+        light_source &s = m.sources[i];
+
+        s.lit.for_each([&](int x, int y) { --m.levels[size_t(y) * size_t(m.width) + size_t(x)]; });
+
+        if (s.radius > 0)
+          s.lit = s.fov.visible;
+        else
+          s.lit.reset(0, 0, 0, 0);
+
+        s.lit.for_each([&](int x, int y) { ++m.levels[size_t(y) * size_t(m.width) + size_t(x)]; });
+        updated = true;
+      }
+
+  return updated;
+}
@@ -0,0 +1,61 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef LIGHT_HPP
+#define LIGHT_HPP
+
+#include <cstdint>
+
+#include "fov.hpp"
+
+/* A light reaches the tiles it would see from its place */
+struct light_source
+{
+  int x      = 0;
+  int y      = 0;
+  int radius = 0;     /* 0 for a removed light */
+  fov_cache fov;      /* the tiles it reaches now */
+  tile_mask lit;      /* the tiles counted in the levels */
+};
+
+/* How many lights reach every tile of a map */
+struct light_map
+{
+  int width  = 0;
+  int height = 0;
+  vector<uint16_t>     levels;
+  vector<light_source> sources;
+  vector<size_t>       unused;  /* removed sources, to be taken again */
+};
+
+/* Remove all the lights from a width x height map */
+void light_reset(light_map &m, int width, int height);
+
+/* Returns the index of the light, which stays the same until it is removed */
+size_t light_add(light_map &m, int x, int y, int radius);
+void   light_move(light_map &m, size_t i, int x, int y);
+void   light_remove(light_map &m, size_t i);
+
+/* Bring the levels to the lights and to the changes of the map, as
+ * fov_update does. Only the lights that moved, were added or removed,
+ * or have a changed tile in range are cast again, on several threads,
+ * and only their tiles are counted anew. Returns false when no level changed */
+bool light_update(light_map &m, const map_changes &changes, const fov_opaque_f &opaque);
+
+inline bool light_lit(const light_map &m, int x, int y)
+{ return m.levels[size_t(y) * size_t(m.width) + size_t(x)] != 0; }
+
+#endif // LIGHT_HPP
@@ -22,7 +22,12 @@
 #include <cstring>
 #include <csignal>
 #include <cerrno>
+#include <clocale>
 #include "ui.hpp"
+#include "headless.hpp"
+#include "painter.hpp"
+#include "map.hpp"
+#include "color.hpp"
 #include "opts.h"
 
 #ifndef PATH_MAX
@@ -40,6 +45,9 @@ int main(int argc, char **argv)
     if (cmdline_parser(argc, argv, &args_info) != 0)
         exit(1);
 
+    /* Wide characters of the maps and texts need the locale of the terminal */
+    setlocale(LC_ALL, "");
+
     const char *home = std::getenv("HOME");
     if (args_info.config_given)
         (CONFIG = args_info.config_arg).append("/");
@@ -50,6 +58,28 @@ int main(int argc, char **argv)
         CONFIG = home + CONFIG;
     }
 
+    if (args_info.export_given) {
+        int status = EXIT_SUCCESS;
+        try {
+            character_map::export_image(args_info.export_arg, args_info.image_arg, args_info.scale_arg);
+        } catch (const game_error &error) {
+            std::cerr << error.what() << std::endl;
+            status = EXIT_FAILURE;
+        }
+        cmdline_parser_free(&args_info);
+        return status;
+    }
+
+    if (args_info.headless_given) {
+        const char *lines = std::getenv("LINES");
+        const char *cols = std::getenv("COLUMNS");
+        int status = headless_run(args_info.headless_arg,
+                                  lines ? atoi(lines) : 24, cols ? atoi(cols) : 80,
+                                  stdin, stdout);
+        cmdline_parser_free(&args_info);
+        return status;
+    }
+
     initscr();
     signal(SIGWINCH, sig_winch);
     curs_set(FALSE);
@@ -57,8 +87,13 @@ int main(int argc, char **argv)
     noecho();
     start_color();
 
-    for (short i = 1; i <= 64; ++i)
-        init_pair(i, (i - 1)%8, (i - 1)/8);
+    color_init();
+
+    if (!strcmp(args_info.output_arg, "ansi")) {
+        window_set_output(OUTPUT_ANSI);
+        if (args_info.thread_flag)
+            painter_start();
+    }
 
     /* Create config directories if they did not exist */
     init_dirs();
@@ -67,6 +102,7 @@ int main(int argc, char **argv)
 
     while(window_top())
         window_hook();
+    painter_stop();
     endwin();
     cmdline_parser_free(&args_info);
 }
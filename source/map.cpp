@@ -15,6 +15,7 @@
 */
 
 #include <map>
+#include <iterator>
 #include <fstream>
 #include <yaml.h>
 
@@ -22,8 +23,10 @@
 #include "map.hpp"
 #include "utils.hpp"
 #include "perlin.hpp"
+#include "color.hpp"
 
 #define FILE_GENERATE "Generation.txt"
+#define FILE_EXPORT   "Export.png"
 
 using std::map;
 using std::ofstream;
@@ -33,6 +36,9 @@ using std::to_string;
 /* Generation (count).txt */
 static string nextgen(const string& s, int count);
 
+/* The first name of the nextgen sequence not taken in the generations folder */
+static string nextfree(const string &name);
+
 static char textures[] = { '~', '#', '\'', '`' };
 static map<char, attr_t> map_attrs = {
   {'~',  PAIR(COLOR_BLUE, COLOR_BLACK)  | DEFAULT_TILE_ATTRIBUTE},
@@ -42,6 +48,18 @@ static map<char, attr_t> map_attrs = {
   {'.',  PAIR(COLOR_CYAN, COLOR_BLACK)  | DEFAULT_TILE_ATTRIBUTE},
   {'(',  PAIR(COLOR_RED, COLOR_BLACK)   | DEFAULT_TILE_ATTRIBUTE},
   {')',  PAIR(COLOR_RED, COLOR_BLACK)   | DEFAULT_TILE_ATTRIBUTE},
+  {'*',  PAIR(COLOR_RED, COLOR_BLACK)   | DEFAULT_TILE_ATTRIBUTE},
+};
+
+/* Water ripples, fire flickers */
+static map<char, vector<cchar>> map_animations = {
+  {'~', { {'~', PAIR(COLOR_BLUE, COLOR_BLACK)},
+          {'~', PAIR(COLOR_BLUE, COLOR_BLACK)},
+          {'-', PAIR(COLOR_BLUE, COLOR_BLACK)},
+          {'~', PAIR(COLOR_CYAN, COLOR_BLACK)} }},
+  {'*', { {'*', PAIR(COLOR_RED, COLOR_BLACK)},
+          {'*', PAIR(COLOR_YELLOW, COLOR_BLACK)},
+          {'+', PAIR(COLOR_RED, COLOR_BLACK)} }},
 };
 
 void character_map::push(const string &s)
@@ -50,7 +68,7 @@ void character_map::push(const string &s)
     throw game_error("Line " + to_string(m_height + 1)
                      + " is empty.");
 
-  int slen = int(s.length());
+  int slen = int(glyph_count(s.c_str(), s.length()));
 
   if (m_width == 0)
     m_width = slen;
@@ -78,14 +96,44 @@ character_map::character_map(const string &id, const string &map, int w, int h)
       this->push(temp);
     }
 
+  std::copy(std::begin(palette()), std::end(palette()), m_palette);
   this->decorate();
 }
 
-character_map& character_map::create_from_yaml(const string &id, const yaml_node_t *node, yaml_document_t *doc)
+static void parse_colors_from_yaml(const yaml_node_t *node, yaml_document_t *doc,
+                                   vector<std::pair<glyph_t, attr_t>> &colors)
+{
+  for (auto b = node->data.mapping.pairs.start; b < node->data.mapping.pairs.top; ++b)
+    {
+      auto node_key = yaml_document_get_node(doc, b->key);
+      auto node_value = yaml_document_get_node(doc, b->value);
+
+      if (node_key->type != YAML_SCALAR_NODE or node_value->type != YAML_SCALAR_NODE)
+        throw game_error("Invalid colors structure of the map.");
+
+      const char *key = reinterpret_cast<const char *>(node_key->data.scalar.value);
+      const char *value = reinterpret_cast<const char *>(node_value->data.scalar.value);
+
+      /* The palette has a place only for the symbols of one byte */
+      auto glyphs = glyph_string(key);
+      if (glyphs.size() != 1 || glyphs.front() >= 256)
+        throw game_error(string("The symbol \"") + key + "\" of the map colors cannot be colored.");
+
+      int color = color_parse(value);
+      if (color < 0)
+        throw game_error(string("Invalid color value \"") + value + "\" in the map colors.");
+
+      colors.emplace_back(glyphs.front(), color_pair(color, COLOR_BLACK) | DEFAULT_TILE_ATTRIBUTE);
+    }
+}
+
+character_map& character_map::create_from_yaml(arena &a, const string &id, const yaml_node_t *node, yaml_document_t *doc)
 {
   string text;
   int w = 0;
   int h = 0;
+  bool dark = false;
+  vector<std::pair<glyph_t, attr_t>> colors;
 
   if (!node)
     throw game_error("Empty map structure.");
@@ -97,10 +145,23 @@ character_map& character_map::create_from_yaml(const string &id, const yaml_node
       auto node_key = yaml_document_get_node(doc, b->key);
       auto node_value = yaml_document_get_node(doc, b->value);
 
-      if (node_key->type != YAML_SCALAR_NODE or node_value->type != YAML_SCALAR_NODE)
+      if (node_key->type != YAML_SCALAR_NODE)
         throw game_error("Invalid map structure.");
 
       const char *key = reinterpret_cast<const char *>(node_key->data.scalar.value);
+
+      /* Colors of the tiles by their symbols: { "~": "#3070ff", ... } */
+      if (!strcmp(key, YAML_MAP_COLORS))
+        {
+          if (node_value->type != YAML_MAPPING_NODE)
+            throw game_error("Invalid colors structure of the map.");
+          parse_colors_from_yaml(node_value, doc, colors);
+          continue;
+        }
+
+      if (node_value->type != YAML_SCALAR_NODE)
+        throw game_error("Invalid map structure.");
+
       const char *value = reinterpret_cast<const char *>(node_value->data.scalar.value);
 
       if (!strcmp(key, YAML_MAP_WIDTH))
@@ -111,22 +172,126 @@ character_map& character_map::create_from_yaml(const string &id, const yaml_node
 
       else if (!strcmp(key, YAML_MAP_TEXT))
         text = value;
+
+      else if (!strcmp(key, YAML_MAP_LIGHTING))
+        {
+          if (!strcmp(value, YAML_MAP_LIGHTING_DARK))
+            dark = true;
+          else if (strcmp(value, YAML_MAP_LIGHTING_DAY))
+            throw game_error(string("Invalid lighting value \"") + value + "\" in the map structure.");
+        }
       else
         throw game_error( string("Found unknown field \"") + key + "\" in the map structure.");
     }
 
-  return *new character_map(id, text, w, h);
+  auto &created = a.make<character_map>(id, text, w, h);
+  created.m_dark = dark;
+
+  if (!colors.empty())
+    {
+      for (auto &color : colors)
+        created.m_palette[color.first] = color.second;
+      created.decorate();
+    }
+  return created;
+}
+
+const attr_t (&character_map::palette())[256]
+{
+  static attr_t palette[256];
+  static bool   palette_ready = false;
+
+  if (!palette_ready)
+    {
+      std::fill(std::begin(palette), std::end(palette), attr_t(DEFAULT_TILE_ATTRIBUTE));
+      for (auto &attr : map_attrs)
+        palette[static_cast<unsigned char>(attr.first)] = attr.second;
+      palette_ready = true;
+    }
+
+  return palette;
+}
+
+const vector<cchar> *character_map::animation(glyph_t symbol)
+{
+  static const vector<cchar> *animations[256];
+  static bool animations_ready = false;
+
+  if (!animations_ready)
+    {
+      for (auto &anim : map_animations)
+        animations[static_cast<unsigned char>(anim.first)] = &anim.second;
+      animations_ready = true;
+    }
+
+  return symbol < SIZE(animations) ? animations[symbol] : nullptr;
 }
 
 void character_map::decorate()
+{ attr_paint(m_palette, 0); }
+
+void character_map::set_symbol(int x, int y, glyph_t symbol)
+{
+  cchar &tile = at(x, y);
+  tile.symbol = symbol;
+  tile.attribute = (tile.attribute & ~attr_t(A_COLOR)) |
+      ((symbol < SIZE(m_palette) ? m_palette[symbol] : attr_t(DEFAULT_TILE_ATTRIBUTE)) & A_COLOR);
+  m_changes.tiles.push_back({x, y});
+}
+
+void character_map::trim_changes(size_t upto)
+{
+  if (upto <= m_changes.first)
+    return;
+
+  m_changes.tiles.erase(m_changes.tiles.begin(), m_changes.tiles.begin() + ptrdiff_t(upto - m_changes.first));
+  m_changes.first = upto;
+}
+
+/* The loops below work on raw rows without bounds checks
+ * and without branches, so the compiler can vectorize them */
+static void attr_apply_row(cchar *row, size_t n, attr_t and_mask, attr_t or_mask)
 {
-  for (auto& line : m_lines) for (size_t i = 0; i < line.lenght; ++i)
+  for (size_t i = 0; i < n; ++i)
+    row[i].attribute = (row[i].attribute & and_mask) | or_mask;
+}
+
+void character_map::attr_apply(attr_t and_mask, attr_t or_mask)
+{
+  for (auto &line : m_lines)
+    attr_apply_row(line.cstr, line.lenght, and_mask, or_mask);
+}
+
+void character_map::attr_apply(int x, int y, int w, int h, attr_t and_mask, attr_t or_mask)
+{
+  int xend = std::min(x + w, m_width);
+  int yend = std::min(y + h, m_height);
+  x = std::max(x, 0);
+  y = std::max(y, 0);
+
+  if (x >= xend)
+    return;
+
+  for (int i = y; i < yend; ++i)
+    attr_apply_row(m_lines[size_t(i)].cstr + x, size_t(xend - x), and_mask, or_mask);
+}
+
+void character_map::attr_apply(const tile_mask &mask, attr_t and_mask, attr_t or_mask)
+{
+  mask.for_each([&](int x, int y) {
+      auto &tile = m_lines[size_t(y)].cstr[x];
+      tile.attribute = (tile.attribute & and_mask) | or_mask;
+    });
+}
+
+void character_map::attr_paint(const attr_t (&palette)[256], attr_t keep_mask)
+{
+  for (auto &line : m_lines)
     {
-      auto attr = map_attrs.find(line.cstr[i].symbol);
-      if (attr != map_attrs.end())
-        line.cstr[i].attribute = attr->second;
-      else
-        line.cstr[i].attribute = DEFAULT_TILE_ATTRIBUTE;
+      cchar *row = line.cstr;
+      for (size_t i = 0; i < line.lenght; ++i)
+        row[i].attribute = (row[i].attribute & keep_mask)
+            | (row[i].symbol < SIZE(palette) ? palette[row[i].symbol] : attr_t(DEFAULT_TILE_ATTRIBUTE));
     }
 }
 
@@ -157,26 +322,38 @@ void character_map::generate(const string& f, int w, int h)
 }
 
 string character_map::generate(int w, int h)
+{
+  string f = CONFIG + DIR_GENERATIONS + nextfree(FILE_GENERATE);
+
+  generate(f, w, h);
+  return f;
+}
+
+string character_map::export_image(bool explored) const
+{
+  string f = CONFIG + DIR_GENERATIONS + nextfree(FILE_EXPORT);
+
+  export_image(f, 1, explored);
+  return f;
+}
+
+string nextfree(const string &name)
 {
   string folder = CONFIG + DIR_GENERATIONS;
 
   ifstream fil;
   int count = 0;
-  string filename = FILE_GENERATE;
+  string filename = name;
 
   do {
       fil.close();
       if (count > 0)
-        filename = nextgen(FILE_GENERATE, count);
+        filename = nextgen(name, count);
       fil.open(folder + filename);
       ++count;
     } while (fil.is_open());
 
-  fil.close();
-  string f = folder + filename;
-
-  generate(f, w, h);
-  return f;
+  return filename;
 }
 
 string nextgen(const string& str, int count)
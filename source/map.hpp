@@ -3,16 +3,95 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <algorithm>
 
 using std::vector;
 using std::string;
 
 #include "utils.hpp"
 #include "base.hpp"
+#include "arena.hpp"
 
 typedef struct yaml_node_s yaml_node_t;
 typedef struct yaml_document_s yaml_document_t;
 
+/* Map coordinates of a tile */
+struct tile_pos
+{
+  int x;
+  int y;
+};
+
+/* One bit per tile of a map area, used to select cells for bulk attribute operations */
+class tile_mask
+{
+  int m_x, m_y, m_width, m_height;
+  vector<uint64_t> m_bits;
+
+  size_t index(int x, int y) const
+  { return size_t(y - m_y) * size_t(m_width) + size_t(x - m_x); }
+
+public:
+
+  tile_mask(int x = 0, int y = 0, int w = 0, int h = 0)
+  { reset(x, y, w, h); }
+
+  /* Place the mask over another area and clear it, reusing the storage */
+  void reset(int x, int y, int w, int h)
+  {
+    m_x = x; m_y = y; m_width = w; m_height = h;
+    m_bits.assign((size_t(w) * size_t(h) + 63) / 64, 0);
+  }
+
+  void set(int x, int y)
+  { auto i = index(x, y); m_bits[i >> 6] |= uint64_t(1) << (i & 63); }
+
+  bool test(int x, int y) const
+  { auto i = index(x, y); return m_bits[i >> 6] >> (i & 63) & 1; }
+
+  bool contains(int x, int y) const
+  { return x >= m_x && y >= m_y && x < m_x + m_width && y < m_y + m_height; }
+
+  void clear()
+  { std::fill(m_bits.begin(), m_bits.end(), 0); }
+
+  /* Place the mask over another area of the same size, keeping the selection */
+  void move_to(int x, int y)
+  { m_x = x; m_y = y; }
+
+  int x()      const { return m_x; }
+  int y()      const { return m_y; }
+  int width()  const { return m_width; }
+  int height() const { return m_height; }
+
+  /* Call f(x, y) with map coordinates of every selected tile, skipping empty words */
+  template <class F>
+  void for_each(F f) const
+  {
+    for (size_t w = 0; w < m_bits.size(); ++w)
+      for (uint64_t bits = m_bits[w]; bits; bits &= bits - 1)
+        {
+          auto i = (w << 6) + size_t(__builtin_ctzll(bits));
+          f(m_x + int(i % size_t(m_width)), m_y + int(i / size_t(m_width)));
+        }
+  }
+};
+
+/* Tiles whose symbols were changed, in order. Positions in the log count
+ * from the start of the map, so they stay right when the log is trimmed */
+struct map_changes
+{
+  size_t           first = 0;  /* changes trimmed from the log */
+  vector<tile_pos> tiles;
+
+  size_t end() const
+  { return first + tiles.size(); }
+
+  const tile_pos& operator[](size_t i) const
+  { return tiles[i - first]; }
+};
+
 class character_map  : public base
 {
     int m_x, m_y;
@@ -20,9 +99,18 @@ class character_map  : public base
     int m_width, m_height;
     vector<text> m_lines;
 
+    /* Only lit tiles can be seen */
+    bool m_dark = false;
+
+    map_changes m_changes;
+
+    /* Attributes of the tiles by their symbols, palette() with the colors of the map */
+    attr_t m_palette[256];
+
     void decorate();
     void push(const string &s);
 
+    friend class arena;
     character_map(const string &id, const string &map, int w, int h);
 
 public:
@@ -31,14 +119,50 @@ public:
   character_map(const character_map &)            = default;
   character_map& operator=(const character_map &) = default;
 
-  static character_map& create_from_yaml(const string &id, const yaml_node_t *node, yaml_document_t *doc);
+  static character_map& create_from_yaml(arena &a, const string &id, const yaml_node_t *node, yaml_document_t *doc);
 
   static void   generate(const string &f, int w, int h);
   static string generate(int w, int h);
 
+  /* Attributes of the tiles by their symbols */
+  static const attr_t (&palette())[256];
+
+  /* Looks the tile with the symbol takes in turn, nullptr if it is not animated */
+  static const vector<cchar> *animation(glyph_t symbol);
+
+  /* Write the map as an image, .png or .ppm by the extension of f,
+   * with a block of scale x scale pixels per tile. With explored,
+   * the tiles the player has not seen yet are black */
+  void   export_image(const string &f, int scale, bool explored) const;
+  string export_image(bool explored) const;
+
+  /* The same for a map file, which is read by bands of lines,
+   * so the memory used does not depend on the map size */
+  static void export_image(const string &map_file, const string &f, int scale);
+
   cchar& at(int x, int y)
   { return m_lines.at( vector<text>::size_type(y) ).cstr[x]; }
 
+  /* Change the symbol of a tile, the tile takes the colors of the symbol.
+   * Fields of view look at the changes, so symbols are not to be changed
+   * through at() */
+  void set_symbol(int x, int y, glyph_t symbol);
+
+  const map_changes& changes() const
+  { return m_changes; }
+
+  /* Forget the changes before upto, all who read the log have looked at them */
+  void trim_changes(size_t upto);
+
+  /* Bulk attribute operations: attribute = (attribute & and_mask) | or_mask */
+  void attr_apply(attr_t and_mask, attr_t or_mask);
+  void attr_apply(int x, int y, int w, int h, attr_t and_mask, attr_t or_mask);
+  void attr_apply(const tile_mask &mask, attr_t and_mask, attr_t or_mask);
+
+  /* attribute = (attribute & keep_mask) | palette[symbol],
+   * glyphs past the palette get DEFAULT_TILE_ATTRIBUTE */
+  void attr_paint(const attr_t (&palette)[256], attr_t keep_mask);
+
   const vector<text>& get_map() const
   { return m_lines; }
 
@@ -63,6 +187,9 @@ public:
   int y() const
   { return m_y; }
 
+  bool dark() const
+  { return m_dark; }
+
 };
 
 #endif // MAP_HPP
@@ -0,0 +1,373 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+
+#include "scenario_constants.hpp"
+#include "map.hpp"
+#include "parallel.hpp"
+#include "color.hpp"
+
+/* Tile lines converted at once, this bounds the memory of an export */
+#define IMAGE_BAND_LINES 64
+
+/* The biggest stored deflate block */
+#define PNG_BLOCK_MAX 65535
+
+using std::ifstream;
+
+/* The foreground of the attribute */
+static void attribute_rgb(attr_t attribute, uint8_t rgb[3])
+{ color_rgb(color_fg(attribute), rgb); }
+
+/* Image file written band by band */
+class image_stream
+{
+  FILE    *m_file = nullptr;
+  bool     m_png;
+  size_t   m_row;
+  int      m_height;
+  int      m_written = 0;
+  uint32_t m_adler   = 1;
+
+  vector<uint8_t> m_chunk;
+
+  void write(const void *data, size_t n);
+  void png_chunk(const char *type, const uint8_t *data, size_t n);
+
+public:
+
+  image_stream(const string &f, int width, int height);
+  ~image_stream();
+
+  /* Lines of width RGB pixels each, every line is repeated scale times */
+  void band(const uint8_t *lines, int count, int scale);
+  void finish();
+};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t n)
+{
+  static uint32_t table[256];
+  static bool     table_ready = false;
+
+  if (!table_ready)
+    {
+      for (uint32_t i = 0; i < 256; ++i)
+        {
+          uint32_t c = i;
+          for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+          table[i] = c;
+        }
+      table_ready = true;
+    }
+
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i)
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t n)
+{
+  uint32_t a = adler & 0xffff, b = adler >> 16;
+
+  /* 5552 bytes are summed before b can overflow */
+  while (n)
+    {
+      size_t k = std::min(n, size_t(5552));
+      n -= k;
+      while (k--)
+        {
+          a += *data++;
+          b += a;
+        }
+      a %= 65521;
+      b %= 65521;
+    }
+
+  return b << 16 | a;
+}
+
+static void put_be32(vector<uint8_t> &v, uint32_t x)
+{
+  v.push_back(uint8_t(x >> 24));
+  v.push_back(uint8_t(x >> 16));
+  v.push_back(uint8_t(x >> 8));
+  v.push_back(uint8_t(x));
+}
+
+image_stream::image_stream(const string &f, int width, int height) :
+  m_height(height)
+{
+  size_t dot = f.rfind('.');
+  string ext = dot == string::npos ? "" : f.substr(dot);
+
+  if (ext == ".png")
+    m_png = true;
+  else if (ext == ".ppm")
+    m_png = false;
+  else
+    throw game_error("Unknown image format of \"" + f + "\", use .png or .ppm.");
+
+  if (width <= 0 || height <= 0 || width > INT32_MAX / 3 - 1)
+    throw game_error("Wrong image size " + std::to_string(width) + "x" + std::to_string(height) + ".");
+
+  m_file = fopen(f.c_str(), "wb");
+  if (!m_file)
+    throw game_error("Can't create file \"" + f + "\".");
+
+  m_row = size_t(width) * 3;
+
+  if (m_png)
+    {
+      static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+      write(signature, sizeof(signature));
+
+      vector<uint8_t> header;
+      put_be32(header, uint32_t(width));
+      put_be32(header, uint32_t(height));
+      /* 8 bits RGB, no interlace */
+      header.insert(header.end(), { 8, 2, 0, 0, 0 });
+      png_chunk("IHDR", header.data(), header.size());
+    }
+  else
+    {
+      char header[64];
+      int n = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+      write(header, size_t(n));
+    }
+}
+
+image_stream::~image_stream()
+{
+  if (m_file)
+    fclose(m_file);
+}
+
+void image_stream::write(const void *data, size_t n)
+{
+  /* Empty chunks have no data to point to */
+  if (!n)
+    return;
+
+  if (fwrite(data, 1, n, m_file) != n)
+    throw game_error(string("Something went wrong when writing the image: ") + strerror(errno));
+}
+
+void image_stream::png_chunk(const char *type, const uint8_t *data, size_t n)
+{
+  vector<uint8_t> head;
+  put_be32(head, uint32_t(n));
+  head.insert(head.end(), type, type + 4);
+
+  uint32_t crc = crc32_update(crc32_update(0, head.data() + 4, 4), data, n);
+  vector<uint8_t> tail;
+  put_be32(tail, crc);
+
+  write(head.data(), head.size());
+  write(data, n);
+  write(tail.data(), tail.size());
+}
+
+/* PNG data is one zlib stream of stored deflate blocks
+ * split into an IDAT chunk per band */
+void image_stream::band(const uint8_t *lines, int count, int scale)
+{
+  if (!m_png)
+    {
+      for (int i = 0; i < count; ++i)
+        for (int k = 0; k < scale; ++k)
+          write(lines + size_t(i) * m_row, m_row);
+      m_written += count * scale;
+      return;
+    }
+
+  m_chunk.clear();
+  if (!m_written)
+    m_chunk.insert(m_chunk.end(), { 0x78, 0x01 });
+
+  /* Every line starts with the filter type 0 */
+  size_t pending = 0;
+  size_t block_head = 0;
+
+  auto open_block = [&]() {
+      block_head = m_chunk.size();
+      m_chunk.insert(m_chunk.end(), 5, 0);
+      pending = 0;
+    };
+  auto close_block = [&](bool last) {
+      m_chunk[block_head]     = last;
+      m_chunk[block_head + 1] = uint8_t(pending);
+      m_chunk[block_head + 2] = uint8_t(pending >> 8);
+      m_chunk[block_head + 3] = uint8_t(~pending);
+      m_chunk[block_head + 4] = uint8_t(~pending >> 8);
+    };
+  auto put = [&](const uint8_t *data, size_t n) {
+      m_adler = adler32_update(m_adler, data, n);
+      while (n)
+        {
+          if (pending == PNG_BLOCK_MAX)
+            {
+              close_block(false);
+              open_block();
+            }
+          size_t k = std::min(n, PNG_BLOCK_MAX - pending);
+          m_chunk.insert(m_chunk.end(), data, data + k);
+          pending += k;
+          data += k;
+          n -= k;
+        }
+    };
+
+  open_block();
+  const uint8_t filter = 0;
+  for (int i = 0; i < count; ++i)
+    for (int k = 0; k < scale; ++k)
+      {
+        put(&filter, 1);
+        put(lines + size_t(i) * m_row, m_row);
+      }
+
+  m_written += count * scale;
+  close_block(m_written == m_height);
+
+  if (m_written == m_height)
+    put_be32(m_chunk, m_adler);
+
+  png_chunk("IDAT", m_chunk.data(), m_chunk.size());
+}
+
+void image_stream::finish()
+{
+  if (m_png)
+    png_chunk("IEND", nullptr, 0);
+
+  FILE *f = m_file;
+  m_file = nullptr;
+  if (fclose(f))
+    throw game_error(string("Something went wrong when writing the image: ") + strerror(errno));
+}
+
+/* One line of pixels for the tiles: RGB repeated scale times per tile */
+static void tiles_rgb(uint8_t *line, const cchar *tiles, int width, int scale, bool explored)
+{
+  for (int j = 0; j < width; ++j)
+    {
+      uint8_t rgb[3] = { 0, 0, 0 };
+      if (!explored || !(tiles[j].attribute & A_INVIS))
+        attribute_rgb(tiles[j].attribute, rgb);
+
+      for (int k = 0; k < scale; ++k, line += 3)
+        memcpy(line, rgb, 3);
+    }
+}
+
+static void symbols_rgb(uint8_t *line, const vector<glyph_t> &symbols, int scale)
+{
+  const attr_t (&palette)[256] = character_map::palette();
+
+  for (glyph_t symbol : symbols)
+    {
+      uint8_t rgb[3];
+      attribute_rgb(symbol < SIZE(palette) ? palette[symbol] : attr_t(DEFAULT_TILE_ATTRIBUTE), rgb);
+
+      for (int k = 0; k < scale; ++k, line += 3)
+        memcpy(line, rgb, 3);
+    }
+}
+
+void character_map::export_image(const string &f, int scale, bool explored) const
+{
+  if (scale < 1 || m_width > INT32_MAX / 4 / scale || m_height > INT32_MAX / scale)
+    throw game_error("Wrong image scale " + std::to_string(scale) + ".");
+
+  image_stream image(f, m_width * scale, m_height * scale);
+
+  size_t row = size_t(m_width) * size_t(scale) * 3;
+  vector<uint8_t> band(row * IMAGE_BAND_LINES);
+
+  for (int y = 0; y < m_height; y += IMAGE_BAND_LINES)
+    {
+      int count = std::min(IMAGE_BAND_LINES, m_height - y);
+
+      parallel_for(count, [&](int i) {
+          tiles_rgb(band.data() + size_t(i) * row, m_lines[size_t(y + i)].cstr, m_width, scale, explored);
+        });
+
+      image.band(band.data(), count, scale);
+    }
+
+  image.finish();
+}
+
+void character_map::export_image(const string &map_file, const string &f, int scale)
+{
+  ifstream fil(map_file);
+  if (!fil.is_open())
+    throw game_error("Can't open file \"" + map_file + "\".");
+
+  /* The image header needs the size before the first band */
+  string line;
+  int width = -1, height = 0;
+
+  while (std::getline(fil, line))
+    {
+      int length = int(glyph_count(line.c_str(), line.length()));
+
+      if (width == -1)
+        width = length;
+      else if (length != width)
+        throw game_error("The lenght of line number " + std::to_string(height + 1) +
+                         " does not match the lenght of the first line.");
+      ++height;
+    }
+
+  if (scale < 1 || width > INT32_MAX / 4 / scale || height > INT32_MAX / scale)
+    throw game_error("Wrong image scale " + std::to_string(scale) + ".");
+
+  image_stream image(f, width * scale, height * scale);
+
+  fil.clear();
+  fil.seekg(0);
+
+  size_t row = size_t(width) * size_t(scale) * 3;
+  vector<uint8_t> band(row * IMAGE_BAND_LINES);
+  vector<vector<glyph_t>> lines(IMAGE_BAND_LINES);
+
+  for (int y = 0; y < height; y += IMAGE_BAND_LINES)
+    {
+      int count = std::min(IMAGE_BAND_LINES, height - y);
+
+      /* Decoding interns new glyphs, which only this thread may do */
+      for (int i = 0; i < count; ++i)
+        {
+          std::getline(fil, line);
+          lines[size_t(i)] = glyph_string(line);
+        }
+
+      parallel_for(count, [&](int i) {
+          symbols_rgb(band.data() + size_t(i) * row, lines[size_t(i)], scale);
+        });
+
+      image.band(band.data(), count, scale);
+    }
+
+  image.finish();
+}
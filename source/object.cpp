@@ -18,20 +18,27 @@
 
 #include "scenario_constants.hpp"
 #include "object.hpp"
+#include "spatial.hpp"
+#include "color.hpp"
 
-object& object::create_from_type(const string &id, const string& type, int x, int y)
+object& object::create_from_type(arena &a, entity_store &s, const object_types &types,
+                                 const string &id, const string& type, int x, int y)
 {
-  if (type == DWARF_TYPE)
-    return *new dwarf(id, x, y);
-  else
-    throw game_error("Unknown object type \"" + type + "\".");
+  for (size_t i = 0; i < types.size(); ++i)
+    if (types[i]->id() == type)
+      return a.make<object>(s, id, x, y, *types[i], uint16_t(i));
+
+  throw game_error("Unknown object type \"" + type + "\".");
 }
 
-object& object::create_from_yaml(const string &id, const yaml_node_t *node, yaml_document_t *doc)
+object& object::create_from_yaml(arena &a, entity_store &s, const object_types &types,
+                                 const string &id, const yaml_node_t *node, yaml_document_t *doc)
 {
   string type;
   int x = 0;
   int y = 0;
+  bool shared = false;
+  int light = 0;
 
   if (!node)
     throw game_error("Empty stucture.");
@@ -57,16 +64,102 @@ object& object::create_from_yaml(const string &id, const yaml_node_t *node, yaml
 
       else if (!strcmp(key, YAML_OBJECT_POSITION_Y))
         y = atoi(value);
+
+      else if (!strcmp(key, YAML_OBJECT_VISION))
+        {
+          if (!strcmp(value, YAML_OBJECT_VISION_SHARED))
+            shared = true;
+          else if (strcmp(value, YAML_OBJECT_VISION_OWN))
+            throw game_error(string("Invalid vision value \"") + value + "\" in the object structure.");
+        }
+
+      else if (!strcmp(key, YAML_OBJECT_LIGHT))
+        light = atoi(value);
       else
         throw game_error( string("Found unknown field \"") + key + "\" in the object structure.");
     }
-  return create_from_type(id, type, x, y);
+  object &created = create_from_type(a, s, types, id, type, x, y);
+  created.share_vision(shared);
+  created.carry_light(light);
+  return created;
+}
+
+bool object::move(int x, int y, glyph_t path)
+{
+  if (!movable(path))
+    return false;
+
+  size_t i = at();
+  m_store.x[i] += x;
+  m_store.y[i] += y;
+
+  if (m_index)
+    spatial_move(*m_index, m_entity.index, m_store.x[i] - x, m_store.y[i] - y, m_store.x[i], m_store.y[i]);
+  return true;
+}
+
+object_type& object_type::create_dwarf(arena &a)
+{
+  return a.make<object_type>(DWARF_TYPE,
+                             cchar{DWARF_SYMBOL, DWARF_ATTR},
+                             DWARF_VISION_RANGE,
+                             DWARF_OBSTACLES,
+                             DWARF_UNVISIBLE);
 }
 
-dwarf::dwarf(const string &id, int x, int y)
-  : object(id, x, y,
-           DWARF_VISION_RANGE,
-           cchar{DWARF_SYMBOL, DWARF_ATTR},
-           DWARF_OBSTACLES,
-           DWARF_UNVISIBLE)
-{};
+object_type& object_type::create_from_yaml(arena &a, const string &id, const yaml_node_t *node, yaml_document_t *doc)
+{
+  cchar symbol = {0, DEFAULT_TYPE_ATTRIBUTE};
+  int vision = DEFAULT_TYPE_VISION_RANGE;
+  string obstacles;
+  string unvisible;
+
+  if (!node)
+    throw game_error("Empty type structure.");
+  else if (node->type != YAML_MAPPING_NODE)
+    throw game_error("Invalid type stucture.");
+
+  for (auto b = node->data.mapping.pairs.start; b < node->data.mapping.pairs.top; ++b)
+    {
+      auto node_key = yaml_document_get_node(doc, b->key);
+      auto node_value = yaml_document_get_node(doc, b->value);
+
+      if (node_key->type != YAML_SCALAR_NODE or node_value->type != YAML_SCALAR_NODE)
+        throw game_error("Invalid type structure.");
+
+      const char *key = reinterpret_cast<const char *>(node_key->data.scalar.value);
+      const char *value = reinterpret_cast<const char *>(node_value->data.scalar.value);
+
+      if (!strcmp(key, YAML_TYPE_SYMBOL))
+        {
+          auto glyphs = glyph_string(value);
+          if (glyphs.size() != 1 || glyph_width(glyphs.front()) != 1)
+            throw game_error("The symbol of the type \"" + id + "\" is not one symbol one column wide.");
+          symbol.symbol = glyphs.front();
+        }
+
+      else if (!strcmp(key, YAML_TYPE_COLOR))
+        {
+          int color = color_parse(value);
+          if (color < 0)
+            throw game_error(string("Invalid color value \"") + value + "\" in the type structure.");
+          symbol.attribute = color_pair(color, COLOR_BLACK) | DEFAULT_TYPE_ATTRIBUTE;
+        }
+
+      else if (!strcmp(key, YAML_TYPE_VISION_RANGE))
+        vision = atoi(value);
+
+      else if (!strcmp(key, YAML_TYPE_OBSTACLES))
+        obstacles = value;
+
+      else if (!strcmp(key, YAML_TYPE_UNVISIBLE))
+        unvisible = value;
+      else
+        throw game_error( string("Found unknown field \"") + key + "\" in the type structure.");
+    }
+
+  if (!symbol.symbol)
+    throw game_error("The type \"" + id + "\" has no symbol.");
+
+  return a.make<object_type>(id, symbol, vision, obstacles, unvisible);
+}
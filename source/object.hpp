@@ -17,60 +17,122 @@
 #ifndef OBJECT_HPP
 #define OBJECT_HPP
 
+#include <vector>
+#include <memory>
+
 #include "utils.hpp"
 #include "base.hpp"
+#include "entity.hpp"
+#include "arena.hpp"
+
+using std::vector;
 
 typedef struct yaml_node_s yaml_node_t;
 typedef struct yaml_document_s yaml_document_t;
 
+struct spatial_hash;
+
+/* What all the objects of a type share. Types are made once per
+ * scenario and are not changed, the objects only refer to them */
+class object_type : public base
+{
+  cchar     m_symbol;
+  int       m_vision_range;
+  glyph_set m_obstacles;
+  glyph_set m_unvisible;
+
+public:
+
+  object_type(const string &id, const cchar &c, int v, const string &i, const string &u)
+    : base(id),
+      m_symbol(c),
+      m_vision_range(v),
+      m_obstacles(glyph_set_of(i)),
+      m_unvisible(glyph_set_of(u)) {}
+
+  object_type(const object_type &)            = delete;
+  object_type& operator=(const object_type &) = delete;
+
+  static object_type& create_from_yaml(arena &a, const string &id, const yaml_node_t *node, yaml_document_t *doc);
+
+  /* The type every scenario knows */
+  static object_type& create_dwarf(arena &a);
+
+  bool movable(glyph_t path) const
+  { return !glyph_in(m_obstacles, path); }
+
+  bool visible(glyph_t path) const
+  { return !glyph_in(m_unvisible, path); }
+
+  const cchar& symbol()       const { return m_symbol; }
+  int          vision_range() const { return m_vision_range; }
+};
+
+/* The types of a scenario, the index of a type is its id */
+using object_types = vector<object_type *>;
+
+/* The state an object changes is kept in an entity of the store,
+ * the object only keeps what is looked up by its id */
 class object : public base
 {
-  int    m_x;
-  int    m_y;
-  int    m_vision_range;
-  cchar  m_symbol;
-  string m_obstacles;
-  string m_unvisible;
-
-protected:
-
-    object(const string &id, int x, int y, int v, const cchar &c, const string &i, const string &u)
-      : base(id),
-        m_x(x),
-        m_y(y),
-        m_vision_range(v),
-        m_symbol(c),
-        m_obstacles(i),
-        m_unvisible(u) {}
+  entity_store      &m_store;
+  entity_t           m_entity;
+  const object_type &m_type;
+
+  /* The index the object is kept in, by the index of its entity */
+  spatial_hash *m_index    = nullptr;
+
+  size_t at() const
+  { return entity_at(m_store, m_entity); }
+
+  friend class arena;
+
+  object(entity_store &s, const string &id, int x, int y, const object_type &type, uint16_t type_id)
+    : base(id),
+      m_store(s),
+      m_entity(entity_create(s, x, y, type.vision_range(), type_id, type.symbol())),
+      m_type(type) {}
 
 public:
 
     object(const object &)            = delete;
     object& operator=(const object &) = delete;
 
-    static object& create_from_type(const string &id, const string& type, int x, int y);
-    static object& create_from_yaml(const string &id, const yaml_node_t *node, yaml_document_t *doc);
+    static object& create_from_type(arena &a, entity_store &s, const object_types &types,
+                                    const string &id, const string& type, int x, int y);
+    static object& create_from_yaml(arena &a, entity_store &s, const object_types &types,
+                                    const string &id, const yaml_node_t *node, yaml_document_t *doc);
 
-    bool move(int x, int y, char path)
-    { return movable(path)? (void(m_x += x), void(m_y += y), true) : false; }
+    bool move(int x, int y, glyph_t path);
 
-    bool movable(char path) const
-    { return m_obstacles.find(path) == string::npos; }
+    /* Keep the index up to date with the moves of the object */
+    void index_in(spatial_hash *index)
+    { m_index = index; }
 
-    bool visible(char path) const
-    { return m_unvisible.find(path) == string::npos; }
+    bool movable(glyph_t path) const
+    { return m_type.movable(path); }
 
-    int          x()            const { return m_x; }
-    int          y()            const { return m_y; }
-    int          vision_range() const { return m_vision_range; }
-    const cchar& symbol()       const { return m_symbol;  }
+    bool visible(glyph_t path) const
+    { return m_type.visible(path); }
 
-    virtual ~object() = default;
-};
+    const object_type& type() const { return m_type; }
+
+    entity_t     entity()       const { return m_entity; }
+    int          x()            const { return m_store.x[at()]; }
+    int          y()            const { return m_store.y[at()]; }
+    int          vision_range() const { return m_store.vision[at()]; }
+
+    /* The player sees what the object sees */
+    bool shared_vision() const { return m_store.shared[at()]; }
+    void share_vision(bool shared) { m_store.shared[at()] = shared; }
+
+    /* The range of the light the object carries, 0 for none */
+    int  light_range() const { return m_store.light[at()]; }
+    void carry_light(int range) { m_store.light[at()] = range; }
+    const cchar& symbol()       const { return m_store.symbol[at()]; }
 
-class dwarf : public object {
-public:    
-    dwarf(const string &id, int x, int y);
+    ~object()
+    { entity_destroy(m_store, m_entity); }
 };
 
 #endif // OBJECT_HPP
@@ -0,0 +1,183 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <semaphore.h>
+
+#include "painter.hpp"
+
+/* Bits of the handoff word: the slot index, a new frame mark and
+ * a mark that the screen is to be written whole. The last one stays
+ * set when an unread frame is replaced, until the painter takes a slot */
+#define PAINTER_SLOT   3u
+#define PAINTER_FRESH  4u
+#define PAINTER_REDRAW 8u
+
+struct painter_slot
+{
+  vector<cell_t> cells;
+  int lines = 0, cols = 0;
+  int y = 0, x = 0;
+  int view_y = 0, view_x = 0;
+
+  /* Nothing should be written, the view is gone */
+  bool cancel = false;
+
+  unsigned long seq = 0;
+};
+
+/* Triple buffer: the poster owns one slot, the painter another,
+ * the third one is exchanged between them */
+static struct painter_slot slots[3];
+static unsigned post_slot  = 0;
+static unsigned paint_slot = 2;
+static std::atomic<unsigned> handoff(1);
+
+static std::thread painter;
+static std::atomic<bool> stopping(false);
+static sem_t wakeup;
+
+/* The sequence number of the last posted and the last written frame */
+static unsigned long posted;
+static unsigned long painted;
+static std::mutex painted_mutex;
+static std::condition_variable painted_cond;
+
+static void painter_loop(void);
+static void painter_handoff(bool redraw);
+
+void painter_start(void)
+{
+  if (painter.joinable())
+    return;
+
+  sem_init(&wakeup, 0, 0);
+  stopping = false;
+  painter = std::thread(painter_loop);
+}
+
+void painter_stop(void)
+{
+  if (!painter.joinable())
+    return;
+
+  painter_sync();
+  stopping = true;
+  sem_post(&wakeup);
+  painter.join();
+  sem_destroy(&wakeup);
+}
+
+bool painter_running(void)
+{ return painter.joinable(); }
+
+void painter_post(const struct frame *f, int y, int x, int view_y, int view_x, bool restore)
+{
+  struct painter_slot &s = slots[post_slot];
+
+  s.cells.assign(f->back.begin(), f->back.end());
+  s.lines   = f->lines;
+  s.cols    = f->cols;
+  s.y       = y;
+  s.x       = x;
+  s.view_y  = view_y;
+  s.view_x  = view_x;
+  s.cancel  = false;
+  s.seq     = ++posted;
+
+  painter_handoff(restore);
+}
+
+void painter_cancel(void)
+{
+  if (!painter.joinable())
+    return;
+
+  struct painter_slot &s = slots[post_slot];
+  s.cancel = true;
+  s.seq    = ++posted;
+
+  painter_handoff(true);
+}
+
+void painter_sync(void)
+{
+  if (!painter.joinable())
+    return;
+
+  std::unique_lock<std::mutex> lock(painted_mutex);
+  painted_cond.wait(lock, [] { return painted == posted; });
+}
+
+/* Publish the poster's slot, an unread frame in the exchanged slot is dropped
+ * but its redraw mark is kept */
+void painter_handoff(bool redraw)
+{
+  unsigned old = handoff.load();
+  unsigned mark = redraw? PAINTER_REDRAW : 0u;
+  while (!handoff.compare_exchange_weak(old, post_slot | PAINTER_FRESH | mark | (old & PAINTER_REDRAW)))
+    ;
+  post_slot = old & PAINTER_SLOT;
+  sem_post(&wakeup);
+}
+
+void painter_loop(void)
+{
+  struct frame screen;
+  int last_view_y = 0, last_view_x = 0;
+
+  for (;;)
+    {
+      while (sem_wait(&wakeup) && errno == EINTR)
+        ;
+
+      if (stopping)
+        return;
+
+      if (!(handoff.load() & PAINTER_FRESH))
+        continue;
+
+      unsigned taken = handoff.exchange(paint_slot);
+      paint_slot = taken & PAINTER_SLOT;
+      struct painter_slot &s = slots[paint_slot];
+
+      if (s.cancel)
+        frame_invalidate(&screen);
+      else
+        {
+          frame_resize(&screen, s.lines, s.cols);
+          if (taken & PAINTER_REDRAW)
+            frame_invalidate(&screen);
+
+          frame_scroll(&screen, s.view_y - last_view_y, s.view_x - last_view_x);
+          last_view_y = s.view_y;
+          last_view_x = s.view_x;
+
+          screen.back.swap(s.cells);
+          frame_flush_ansi(&screen, s.y, s.x);
+        }
+
+      {
+        std::lock_guard<std::mutex> lock(painted_mutex);
+        painted = s.seq;
+      }
+      painted_cond.notify_all();
+    }
+}
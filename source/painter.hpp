@@ -0,0 +1,45 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PAINTER_HPP
+#define PAINTER_HPP
+
+#include "frame.hpp"
+
+/* The painter is a thread writing the game view with the ANSI output.
+ * Frames are handed to it without locking, an unwritten frame is replaced
+ * by a newer one, so a slow terminal delays only the picture
+ * and never the input. ncurses is not thread-safe: only the ANSI output,
+ * which writes by itself, can be moved to the painter */
+void painter_start(void);
+void painter_stop(void);
+bool painter_running(void);
+
+/* Hand the back buffer of f, to be shown at the screen position (y, x).
+ * The view (view_y, view_x) lets the painter scroll one-step moves.
+ * With restore, everything is written even if it looks unchanged,
+ * also when the frame is replaced before it is written */
+void painter_post(const struct frame *f, int y, int x, int view_y, int view_x, bool restore);
+
+/* Forget frames not written yet, the next frame is written whole */
+void painter_cancel(void);
+
+/* Wait until the posted frames are on the screen,
+ * so that ncurses can write to the terminal */
+void painter_sync(void);
+
+#endif // PAINTER_HPP
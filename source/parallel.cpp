@@ -0,0 +1,109 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* Workers started on the first call and kept waiting for the next ones.
+ * The pool is never freed: the workers are still waiting when the game exits */
+struct pool
+{
+  std::mutex              call;      /* one parallel_for at a time */
+  std::mutex              mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+
+  const std::function<void(int)> *f = nullptr;
+  int              n       = 0;
+  int              wanted  = 0;  /* workers asked to join the current call */
+  int              running = 0;  /* workers still in the current call */
+  unsigned         round   = 0;
+  std::atomic<int> next{0};
+};
+
+static void take(pool *p)
+{
+  for (int i = p->next++; i < p->n; i = p->next++)
+    (*p->f)(i);
+}
+
+static void work(pool *p, int index)
+{
+  unsigned seen = 0;
+
+  for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(p->mutex);
+        p->wake.wait(lock, [&] { return p->round != seen && index < p->wanted; });
+        seen = p->round;
+      }
+
+      take(p);
+
+      std::lock_guard<std::mutex> lock(p->mutex);
+      if (--p->running == 0)
+        p->done.notify_one();
+    }
+}
+
+int parallel_threads(void)
+{
+  static int threads = std::max(1, int(std::thread::hardware_concurrency()));
+  return threads;
+}
+
+void parallel_for(int n, const std::function<void(int)> &f)
+{
+  static pool *p = nullptr;
+
+  int workers = std::min(n, parallel_threads()) - 1;
+  if (workers < 1)
+    {
+      for (int i = 0; i < n; ++i)
+        f(i);
+      return;
+    }
+
+  if (!p)
+    {
+      p = new pool;
+      for (int i = 0; i < parallel_threads() - 1; ++i)
+        std::thread(work, p, i).detach();
+    }
+
+  std::lock_guard<std::mutex> call(p->call);
+  {
+    std::lock_guard<std::mutex> lock(p->mutex);
+    p->f = &f;
+    p->n = n;
+    p->next = 0;
+    p->wanted = p->running = workers;
+    ++p->round;
+  }
+  p->wake.notify_all();
+
+  take(p);
+
+  std::unique_lock<std::mutex> lock(p->mutex);
+  p->done.wait(lock, [&] { return p->running == 0; });
+}
@@ -0,0 +1,31 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <functional>
+
+/* The count of threads parallel_for uses, the calling one included */
+int parallel_threads(void);
+
+/* Call f(0), ..., f(n - 1) on several threads and return when all calls are done.
+ * The calls take indexes in order, so neighbouring ones run close in time.
+ * The threads are kept between calls, so short loops are worth running too */
+void parallel_for(int n, const std::function<void(int)> &f);
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,251 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <algorithm>
+
+#include "path.hpp"
+
+#define PATH_NONE UINT32_MAX
+
+void path_grid_reset(path_grid &g, int width, int height, const map_changes &changes,
+                     const path_passable_f &passable)
+{
+  g.width = width;
+  g.height = height;
+  g.changes = changes.end();
+  g.open.assign(size_t(width + 2) * size_t(height + 2), 0);
+
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      g.open[size_t(y + 1) * size_t(width + 2) + size_t(x + 1)] = passable(x, y);
+}
+
+void path_grid_update(path_grid &g, const map_changes &changes, const path_passable_f &passable)
+{
+  for (; g.changes < changes.end(); ++g.changes)
+    {
+      const tile_pos &t = changes[g.changes];
+      g.open[size_t(t.y + 1) * size_t(g.width + 2) + size_t(t.x + 1)] = passable(t.x, t.y);
+    }
+}
+
+/* Tiles are indexes in the grid, the border included */
+struct path_query
+{
+  path_search     &s;
+  const path_grid &grid;
+  const uint8_t   *open;
+  int32_t  stride;
+  uint32_t start;
+  uint32_t goal;
+  int      gx, gy;
+
+  path_query(path_search &search, const path_grid &g, int x0, int y0, int x1, int y1)
+    : s(search), grid(g), open(g.open.data()), stride(g.width + 2),
+      start(tile(x0, y0)), goal(tile(x1, y1)), gx(x1), gy(y1)
+  {
+    if (s.size != g.open.size())
+      {
+        s.size = g.open.size();
+        s.stamp.assign(s.size, 0);
+        s.g.resize(s.size);
+        s.parent.resize(s.size);
+        s.generation = 0;
+      }
+
+    if (++s.generation == 0)
+      {
+        std::fill(s.stamp.begin(), s.stamp.end(), 0);
+        s.generation = 1;
+      }
+    s.heap.clear();
+  }
+
+  uint32_t tile(int x, int y) const
+  { return uint32_t((y + 1) * stride + x + 1); }
+
+  int x(uint32_t t) const { return int(t % uint32_t(stride)) - 1; }
+  int y(uint32_t t) const { return int(t / uint32_t(stride)) - 1; }
+
+  uint32_t distance(uint32_t a, uint32_t b) const
+  { return uint32_t(std::abs(x(a) - x(b)) + std::abs(y(a) - y(b))); }
+
+  /* The lowest cost first, of the same cost the deepest */
+  static bool later(const path_node &a, const path_node &b)
+  { return a.f > b.f || (a.f == b.f && a.g < b.g); }
+
+  /* A path of cost g to the tile through parent */
+  void reach(uint32_t t, uint32_t g, uint32_t parent)
+  {
+    if (s.stamp[t] == s.generation && s.g[t] <= g)
+      return;
+
+    s.stamp[t] = s.generation;
+    s.g[t] = g;
+    s.parent[t] = parent;
+    s.heap.push_back({g + distance(t, goal), g, t});
+    std::push_heap(s.heap.begin(), s.heap.end(), later);
+  }
+
+  /* The next tile to expand, PATH_NONE when there is none left */
+  uint32_t next(uint32_t &g)
+  {
+    while (!s.heap.empty())
+      {
+        std::pop_heap(s.heap.begin(), s.heap.end(), later);
+        path_node n = s.heap.back();
+        s.heap.pop_back();
+
+        /* A cheaper path to the tile was found after this one */
+        if (n.g == s.g[n.tile])
+          {
+            g = n.g;
+            return n.tile;
+          }
+      }
+    return PATH_NONE;
+  }
+
+  /* Walk back from the goal, filling the lines between the tiles */
+  void trace(vector<tile_pos> &path) const
+  {
+    path.clear();
+    for (uint32_t t = goal; t != start; t = s.parent[t])
+      {
+        uint32_t p = s.parent[t];
+        int tx = x(t), ty = y(t);
+        int dx = (x(p) > tx) - (x(p) < tx);
+        int dy = (y(p) > ty) - (y(p) < ty);
+
+        for (; tx != x(p) || ty != y(p); tx += dx, ty += dy)
+          path.push_back({tx, ty});
+      }
+    std::reverse(path.begin(), path.end());
+  }
+
+  bool valid(int x0, int y0, int x1, int y1) const
+  {
+    return x0 >= 0 && y0 >= 0 && x0 < grid.width && y0 < grid.height &&
+           x1 >= 0 && y1 >= 0 && x1 < grid.width && y1 < grid.height && open[goal];
+  }
+
+  /* Run along a column by d, stop at the goal or where a path may turn
+   * into the row because a closed tile behind kept it from turning earlier */
+  uint32_t vertical(uint32_t t, int32_t d) const
+  {
+    for (;;)
+      {
+        t += uint32_t(d);
+        if (!open[t])
+          return PATH_NONE;
+        if (t == goal)
+          return t;
+        if ((open[t - 1] && !open[t - 1 - uint32_t(d)]) || (open[t + 1] && !open[t + 1 - uint32_t(d)]))
+          return t;
+      }
+  }
+
+  /* Run along a row by d. Paths turn from rows into columns, so the run
+   * also stops where a run along the column finds something */
+  uint32_t horizontal(uint32_t t, int32_t d) const
+  {
+    uint32_t up = uint32_t(stride);
+    for (;;)
+      {
+        t += uint32_t(d);
+        if (!open[t])
+          return PATH_NONE;
+        if (t == goal)
+          return t;
+        if ((open[t - up] && !open[t - up - uint32_t(d)]) || (open[t + up] && !open[t + up - uint32_t(d)]))
+          return t;
+        if (vertical(t, stride) != PATH_NONE || vertical(t, -stride) != PATH_NONE)
+          return t;
+      }
+  }
+};
+
+bool path_astar(path_search &s, const path_grid &grid, int x0, int y0, int x1, int y1, vector<tile_pos> &path)
+{
+  path_query q(s, grid, x0, y0, x1, y1);
+  if (!q.valid(x0, y0, x1, y1))
+    return false;
+
+  const int32_t steps[4] = { 1, q.stride, -1, -q.stride };
+
+  q.reach(q.start, 0, q.start);
+  uint32_t g;
+  for (uint32_t t; (t = q.next(g)) != PATH_NONE; )
+    {
+      if (t == q.goal)
+        {
+          q.trace(path);
+          return true;
+        }
+
+      for (int32_t step : steps)
+        if (q.open[t + uint32_t(step)])
+          q.reach(t + uint32_t(step), g + 1, t);
+    }
+
+  return false;
+}
+
+bool path_jps(path_search &s, const path_grid &grid, int x0, int y0, int x1, int y1, vector<tile_pos> &path)
+{
+  path_query q(s, grid, x0, y0, x1, y1);
+  if (!q.valid(x0, y0, x1, y1))
+    return false;
+
+  auto jump = [&](uint32_t t, uint32_t g, int32_t d) {
+      uint32_t j = (d == 1 || d == -1)? q.horizontal(t, d) : q.vertical(t, d);
+      if (j != PATH_NONE)
+        q.reach(j, g + q.distance(t, j), t);
+    };
+
+  q.reach(q.start, 0, q.start);
+  uint32_t g;
+  for (uint32_t t; (t = q.next(g)) != PATH_NONE; )
+    {
+      if (t == q.goal)
+        {
+          q.trace(path);
+          return true;
+        }
+
+      uint32_t p = s.parent[t];
+
+      /* Ahead and to both sides, never back */
+      if (t == q.start || q.y(p) == q.y(t))
+        {
+          int32_t d = t == q.start? 0 : (q.x(t) > q.x(p)? 1 : -1);
+          if (d != -1) jump(t, g, 1);
+          if (d != 1)  jump(t, g, -1);
+          jump(t, g, q.stride);
+          jump(t, g, -q.stride);
+        }
+      else
+        {
+          int32_t d = q.y(t) > q.y(p)? q.stride : -q.stride;
+          jump(t, g, d);
+          jump(t, g, 1);
+          jump(t, g, -1);
+        }
+    }
+
+  return false;
+}
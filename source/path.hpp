@@ -0,0 +1,78 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef PATH_HPP
+#define PATH_HPP
+
+#include <cstdint>
+#include <functional>
+
+#include "map.hpp"
+
+/* Tells if the tile (x, y) of the map can be stepped on */
+typedef std::function<bool(int x, int y)> path_passable_f;
+
+/* The tiles that can be stepped on, one byte per tile, with a border
+ * of closed tiles around the map so that no step leaves the grid */
+struct path_grid
+{
+  int    width   = 0;
+  int    height  = 0;
+  size_t changes = 0;  /* map changes already looked at */
+  vector<uint8_t> open;
+};
+
+/* Fill the grid for a width x height map with the changes made so far */
+void path_grid_reset(path_grid &g, int width, int height, const map_changes &changes,
+                     const path_passable_f &passable);
+
+/* Look again at the tiles changed on the map since the last call. The log
+ * is not to be trimmed past the changes the grid has looked at */
+void path_grid_update(path_grid &g, const map_changes &changes, const path_passable_f &passable);
+
+struct path_node
+{
+  uint32_t f;     /* cost so far and the estimate of the rest */
+  uint32_t g;     /* cost so far */
+  uint32_t tile;
+};
+
+/* The buffers of a search, kept between searches so that a search on a
+ * grid of the same size allocates nothing. A tile belongs to the current
+ * search only when its stamp is the generation of the search */
+struct path_search
+{
+  size_t   size       = 0;
+  uint32_t generation = 0;
+
+  vector<uint32_t>  stamp;
+  vector<uint32_t>  g;
+  vector<uint32_t>  parent;
+  vector<path_node> heap;
+};
+
+/* The shortest path from (x0, y0) to (x1, y1) by steps along the axes.
+ * path is set to the tiles of the path, the start excluded. Returns
+ * false when there is no path */
+bool path_astar(path_search &s, const path_grid &grid, int x0, int y0, int x1, int y1, vector<tile_pos> &path);
+
+/* The same with jump point search: the search runs over the tiles of
+ * straight lines as long as no other path of the same cost has to turn
+ * there, and keeps in the heap only the tiles where paths turn. Every
+ * step costs the same, so the path is as short as that of path_astar */
+bool path_jps(path_search &s, const path_grid &grid, int x0, int y0, int x1, int y1, vector<tile_pos> &path);
+
+#endif // PATH_HPP
@@ -24,10 +24,26 @@
 constexpr const char *YAML_SECTION_OBJECTS = "objects";
 constexpr const char *YAML_SECTION_EVENTS  = "events";
 constexpr const char *YAML_SECTION_MAPS    = "maps";
+constexpr const char *YAML_SECTION_TYPES   = "types";
 
 constexpr const char *YAML_OBJECT_TYPE       = "type";
 constexpr const char *YAML_OBJECT_POSITION_X = "x";
 constexpr const char *YAML_OBJECT_POSITION_Y = "y";
+constexpr const char *YAML_OBJECT_VISION     = "vision";
+constexpr const char *YAML_OBJECT_LIGHT      = "light";
+
+constexpr const char *YAML_OBJECT_VISION_SHARED = "Shared";
+constexpr const char *YAML_OBJECT_VISION_OWN    = "Own";
+
+constexpr const char *YAML_TYPE_SYMBOL       = "symbol";
+constexpr const char *YAML_TYPE_COLOR        = "color";
+constexpr const char *YAML_TYPE_VISION_RANGE = "sight";
+constexpr const char *YAML_TYPE_OBSTACLES    = "obstacles";
+constexpr const char *YAML_TYPE_UNVISIBLE    = "opaque";
+
+/* In the order of the curses colors */
+constexpr const char *YAML_COLORS[] = {"Black", "Red", "Green", "Yellow", "Blue", "Magenta", "Cyan", "White"};
+constexpr size_t      YAML_COLORS_SIZE = sizeof(YAML_COLORS) / sizeof(*YAML_COLORS);
 
 constexpr const char *YAML_EVENT_CONDITIONS     = "if";
 constexpr const char *YAML_EVENT_MESSAGE        = "message";
@@ -44,6 +60,11 @@ constexpr const char *YAML_EVENT_ITEM_COMMANDS  = "do";
 constexpr const char *YAML_MAP_WIDTH  = "width";
 constexpr const char *YAML_MAP_HEIGHT = "height";
 constexpr const char *YAML_MAP_TEXT   = "text";
+constexpr const char *YAML_MAP_LIGHTING = "lighting";
+constexpr const char *YAML_MAP_COLORS   = "colors";
+
+constexpr const char *YAML_MAP_LIGHTING_DAY  = "Day";
+constexpr const char *YAML_MAP_LIGHTING_DARK = "Dark";
 
 constexpr const char    *DEFAULT_PARSE_ERROR       = "YAML configuration does not match the scenario specification.";
 constexpr position       DEFAULT_EVENT_SIZE        = POSITION_SMALL;
@@ -51,6 +72,14 @@ constexpr attr_t         DEFAULT_EVENT_ATTRIBUTE   = PAIR(NEUTRAL_COLOR, COLOR_B
 constexpr const char    *DEFAULT_PLAYER_ID         = "player";
 constexpr const char    *DEFAULT_MAP_ID            = "map";
 constexpr int            DEFAULT_TILE_ATTRIBUTE    = A_INVIS;
+constexpr int            DEFAULT_VIEW_MARGIN       = 2;
+constexpr attr_t         DEFAULT_TYPE_ATTRIBUTE    = A_BOLD;
+constexpr int            DEFAULT_TYPE_VISION_RANGE = 10;
+
+/* On dark maps: fire gives light, walls stop it */
+constexpr const char *LIGHT_TILES      = "*";
+constexpr int         LIGHT_TILE_RANGE = 5;
+constexpr const char *LIGHT_OPAQUE     = "#";
 
 constexpr const char *RESERVED_SCENARIO_ID = "scenario";
 constexpr const char *RESERVED_DIALOG_ID = "dialog";
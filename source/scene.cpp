@@ -15,6 +15,8 @@
 */
 
 #include <cstdio>
+#include <cstdint>
+#include <cstdlib>
 #include <limits>
 #include <cstring>
 #include <sstream>
@@ -23,6 +25,8 @@
 #include <algorithm>
 #include <string>
 #include <memory>
+#include <chrono>
+#include <unordered_map>
 
 #include "scenario_constants.hpp"
 #include "scene.hpp"
@@ -30,7 +34,13 @@
 #include "map.hpp"
 #include "event.hpp"
 #include "object.hpp"
+#include "entity.hpp"
 #include "window.hpp"
+#include "fov.hpp"
+#include "light.hpp"
+#include "spatial.hpp"
+#include "path.hpp"
+#include "parallel.hpp"
 
 using std::to_string;
 using std::string;
@@ -44,20 +54,90 @@ using std::string;
 
 void parse_call(const string &call, string &id, string &method, string &args);
 
-using events = vector<unique_ptr<event>>;
-using objects = vector<unique_ptr<object>>;
+using events = vector<event *>;
+using objects = vector<object *>;
 
 class scenario {
 
   string                    m_file;
   int                       m_lines;
   int                       m_cols;
-  unique_ptr<character_map> m_source      = nullptr;
-  unique_ptr<character_map> m_render      = nullptr;
+  character_map            *m_source      = nullptr;
   render_f                  m_render_f;
   events                    m_events;
+
+  object_types              m_types;
+
+  /* The objects give their entities back when destroyed, so the
+   * store is to be destroyed after the arena */
+  entity_store              m_entities;
+
+  /* Owns the maps, events, types and objects, frees them at once */
+  arena                     m_arena;
   objects                   m_objects;
-  objects::iterator         m_player      = m_objects.end();
+  object                   *m_player      = nullptr;
+
+  /* The objects by their places, as entity indexes, and by their ids */
+  spatial_hash              m_spatial;
+  std::unordered_map<string, size_t> m_object_ids;
+  vector<size_t>            m_found;
+  vector<fov_cache>         m_fovs;
+  tile_mask                 m_seen;
+
+  /* Lights of a dark map: those the objects carry, by the object,
+   * and those of the light tiles, by the place of the tile */
+  light_map                 m_light;
+  vector<size_t>            m_object_lights;
+  std::unordered_map<size_t, size_t> m_tile_lights;
+  size_t                    m_light_changes = 0;
+
+  /* An object walking somewhere follows the path found for it until
+   * the goal, the map or its place changes */
+  struct walk_plan
+  {
+    tile_pos         goal    = {-1, -1};
+    tile_pos         from    = {-1, -1};
+    size_t           changes = 0;
+    size_t           step    = 0;
+    vector<tile_pos> tiles;
+  };
+
+  /* The tiles each type can step on, by the type, and the plans by the entity index */
+  path_search               m_path;
+  vector<path_grid>         m_path_grids;
+  vector<walk_plan>         m_walks;
+
+  /* Lines of sight asked this turn, by the type of the viewer and the line */
+  struct los_query
+  {
+    size_t   type;
+    fov_line line;
+
+    bool operator==(const los_query &q) const
+    {
+      return type == q.type && line.x0 == q.line.x0 && line.y0 == q.line.y0 &&
+             line.x1 == q.line.x1 && line.y1 == q.line.y1;
+    }
+  };
+
+  struct los_hash
+  {
+    size_t operator()(const los_query &q) const
+    {
+      uint64_t h = q.type;
+      for (int v : {q.line.x0, q.line.y0, q.line.x1, q.line.y1})
+        h = (h ^ uint32_t(v)) * 0x100000001b3ull;
+      return size_t(h ^ h >> 32);
+    }
+  };
+
+  mutable std::unordered_map<los_query, bool, los_hash> m_los;
+  mutable size_t            m_los_changes = 0;
+  vector<text>              m_view;
+  int                       m_view_x      = 0;
+  int                       m_view_y      = 0;
+  vector<int>               m_animated;
+  unsigned                  m_tick        = 0;
   vector<string>            m_identifiers = {RESERVED_DIALOG_ID, RESERVED_SCENARIO_ID};
 
   objects::const_iterator find_object(const string& id) const;
@@ -73,10 +153,30 @@ class scenario {
   { return y >= m_source->height() || y < 0; }
 
   void add_id(const string &id);
-  void render_los(const object& viewer);
-  void render_set_visible(int x, int y);
-  void source_set_detected(int x, int y);
+  bool opaque(const object_type &viewer, int x, int y) const
+  { return !abroad(x, y) && !viewer.visible(m_source->at(x, y).symbol); }
+
+  /* On a dark map the viewer at (vx, vy) sees only the lit tiles and those next to it */
+  bool lit(int vx, int vy, int x, int y) const
+  {
+    return !m_source->dark() || light_lit(m_light, x, y) ||
+           (std::abs(x - vx) <= 1 && std::abs(y - vy) <= 1);
+  }
+
+  void light_init();
+  bool render_light();
+  bool render_fov();
+  bool sees(const object &viewer, int x, int y) const;
+  void render_set_visible();
+  void source_set_detected();
+  void render_view();
+  void render_animated();
+  void render_looks();
   void turn();
+  void walk(object &o, int x, int y);
+  path_grid& path_grid_of(size_t type);
+  void trim_changes();
+  void set_tile(int x, int y, glyph_t symbol);
   void load(const string &f);
   void parse_yaml();
   void parse_yaml(const char *section_type, const yaml_node_t *node, yaml_document_t *doc);
@@ -98,6 +198,18 @@ public:
   scenario(const string &f, render_f r_f, int l, int c);
 
   void render();
+  void tick();
+
+  string export_image() const
+  { return m_source->export_image(true); }
+
+  string fov_compare() const;
+
+  bool los(int x0, int y0, int x1, int y1) const;
+  void los(const vector<fov_line> &lines, vector<char> &seen) const;
+  bool los(size_t viewer, int x0, int y0, int x1, int y1) const;
+  void los(size_t viewer, const vector<fov_line> &lines, vector<char> &seen) const;
+
   void set_view   (int x, int y);
   void move_player(int x, int y);
   void move_view  (int x, int y);
@@ -111,10 +223,12 @@ static unique_ptr<scenario> single_scenario;
 scenario::scenario(const string &f, render_f r_f, int l, int c) :
   m_lines(l), m_cols(c), m_render_f(r_f)
 {
+  m_types.push_back(&object_type::create_dwarf(m_arena));
   load(f);
+  light_init();
 
-  set_view((*m_player)->x() - m_cols/2,
-           (*m_player)->y() - m_lines/2);
+  set_view(m_player->x() - m_cols/2,
+           m_player->y() - m_lines/2);
 }
 
 void scenario::load(const string& f)
@@ -125,8 +239,8 @@ void scenario::load(const string& f)
 
 void scenario::move_player(int x, int y)
 {
-  int px = (*m_player)->x();
-  int py = (*m_player)->y();
+  int px = m_player->x();
+  int py = m_player->y();
 
   /* Return view to player */
   set_view(px - m_cols / 2, py - m_lines / 2);
@@ -137,7 +251,7 @@ void scenario::move_player(int x, int y)
   if (abroad(npx, npy))
     return;
 
-  if ((*m_player)->move(x, y, m_source->at(npx, npy).symbol))
+  if (m_player->move(x, y, m_source->at(npx, npy).symbol))
     {
       set_view(npx - m_cols / 2, npy - m_lines / 2);
       turn();
@@ -156,113 +270,287 @@ void scenario::set_view(int x, int y)
 void scenario::move_view(int x, int y)
 {
   set_view(m_source->x() + x, m_source->y() + y);
+  render();
 }
 
-void scenario::render_set_visible(int x, int y)
+void scenario::render_set_visible()
 {
-  m_render->at(x, y).attribute &= ~(A_INVIS | A_DIM);
-  m_render->at(x, y).attribute |= A_BOLD;
+  int view_w = m_cols + DEFAULT_VIEW_MARGIN * 2;
+  int view_h = m_lines + DEFAULT_VIEW_MARGIN * 2;
+
+  m_seen.for_each([&](int x, int y) {
+      x -= m_view_x;
+      y -= m_view_y;
+
+      if (x < 0 || y < 0 || x >= view_w || y >= view_h)
+        return;
+
+      auto &tile = m_view[size_t(y)].cstr[x];
+      tile.attribute = (tile.attribute & ~attr_t(A_INVIS | A_DIM)) | A_BOLD;
+    });
+}
+
+void scenario::source_set_detected()
+{ m_source->attr_apply(m_seen, ~attr_t(A_INVIS), A_DIM); }
+
+static bool light_tile(glyph_t symbol)
+{
+  static const glyph_set tiles = glyph_set_of(LIGHT_TILES);
+  return glyph_in(tiles, symbol);
 }
 
-void scenario::source_set_detected(int x, int y)
+static bool light_opaque(glyph_t symbol)
 {
-  m_source->at(x, y).attribute &= ~A_INVIS;
-  m_source->at(x, y).attribute |= A_DIM;
+  static const glyph_set tiles = glyph_set_of(LIGHT_OPAQUE);
+  return glyph_in(tiles, symbol);
+}
+
+/* Light the objects carrying a light and the light tiles of a dark map */
+void scenario::light_init()
+{
+  if (!m_source->dark())
+    return;
+
+  light_reset(m_light, width(), height());
+
+  const entity_store &e = m_entities;
+  m_object_lights.assign(e.dense.size(), SIZE_MAX);
+  for (size_t i = 0; i < entity_count(e); ++i)
+    if (e.light[i] > 0)
+      m_object_lights[e.handle[i].index] = light_add(m_light, e.x[i], e.y[i], e.light[i]);
+
+  for (int y = 0; y < height(); ++y)
+    for (int x = 0; x < width(); ++x)
+      if (light_tile(m_source->at(x, y).symbol))
+        m_tile_lights[size_t(y) * size_t(width()) + size_t(x)] = light_add(m_light, x, y, LIGHT_TILE_RANGE);
+
+  m_light_changes = m_source->changes().end();
 }
 
-void scenario::render_los(const object &viewer)
+/* Follow the objects carrying a light and the light tiles put on
+ * or taken off the map. Returns false when the light map is the same */
+bool scenario::render_light()
 {
-  using std::hypot;
+  if (!m_source->dark())
+    return false;
+
+  const entity_store &e = m_entities;
+  for (size_t i = 0; i < entity_count(e); ++i)
+    if (e.light[i] > 0)
+      light_move(m_light, m_object_lights[e.handle[i].index], e.x[i], e.y[i]);
+
+  auto &changes = m_source->changes();
+  for (m_light_changes = std::max(m_light_changes, changes.first); m_light_changes < changes.end(); ++m_light_changes)
+    {
+      const tile_pos &tile = changes[m_light_changes];
+      size_t place = size_t(tile.y) * size_t(width()) + size_t(tile.x);
+      bool emits = light_tile(m_source->at(tile.x, tile.y).symbol);
+      auto found = m_tile_lights.find(place);
 
-  int vision_range = viewer.vision_range();
+      if (emits && found == m_tile_lights.end())
+        m_tile_lights[place] = light_add(m_light, tile.x, tile.y, LIGHT_TILE_RANGE);
 
-  int px = viewer.x();
-  int py = viewer.y();
+      else if (!emits && found != m_tile_lights.end())
+        {
+          light_remove(m_light, found->second);
+          m_tile_lights.erase(found);
+        }
+    }
 
-  for (int y = py - vision_range; y < py + vision_range; ++y)
-    for (int x = px - vision_range; x < px + vision_range; ++x)
+  return light_update(m_light, changes, [&](int x, int y) {
+      return !abroad(x, y) && light_opaque(m_source->at(x, y).symbol);
+    });
+}
+
+/* Update the fields of view of all the objects, one per thread, and merge
+ * those the player shares into m_seen. Returns false when m_seen is the same.
+ * The fields of view are kept by entity index */
+bool scenario::render_fov()
+{
+  bool lights = render_light();
+  const entity_store &e = m_entities;
+  size_t n = entity_count(e);
+  vector<char> changed(n);
+
+  m_fovs.resize(e.dense.size());
+  parallel_for(int(n), [&](int i) {
+      entity_t h = e.handle[size_t(i)];
+      const object_type &viewer = *m_types[e.type[size_t(i)]];
+
+      changed[size_t(i)] = fov_update(m_fovs[h.index], e.x[size_t(i)], e.y[size_t(i)], e.vision[size_t(i)],
+                                      width(), height(), m_source->changes(),
+                                      [&](int x, int y) { return opaque(viewer, x, y); });
+    });
+
+  uint32_t player = m_player->entity().index;
+  auto shown = [&](size_t i) { return e.shared[i] || e.handle[i].index == player; };
+
+  /* m_seen covers only the union of the shown fields of view on the map,
+   * its storage is kept between turns */
+  int x0 = width(), y0 = height(), x1 = 0, y1 = 0;
+  bool merge = lights;
+  for (size_t i = 0; i < n; ++i)
+    if (shown(i))
       {
-        if (round(hypot(x - px, y - py)) >= vision_range) continue;
-
-        int px = viewer.x();
-        int py = viewer.y();
-
-        int delta_x(x - px);
-
-        signed char const ix((delta_x > 0) - (delta_x < 0));
-        delta_x = std::abs(delta_x) << 1;
-
-        int delta_y(y - py);
-
-        signed char const iy((delta_y > 0) - (delta_y < 0));
-        delta_y = std::abs(delta_y) << 1;
-
-        if (!abroad(x, y))
-          {
-            source_set_detected(px, py);
-            render_set_visible(px, py);
-            if (!viewer.visible(m_source->at(px, py).symbol))
-              goto next_line;
-          }
-
-        if (delta_x >= delta_y)
-          {
-            int error(delta_y - (delta_x >> 1));
-
-            while (px != x)
-              {
-                if ((error > 0) || (!error && (ix > 0)))
-                  {
-                    error -= delta_x;
-                    py += iy;
-                  }
-
-                error += delta_y;
-                px += ix;
-
-                if (!abroad(px, py))
-                  {
-                    source_set_detected(px, py);
-                    render_set_visible(px, py);
-                    if (!viewer.visible(m_source->at(px, py).symbol))
-                      goto next_line;
-                  }
-              }
-          }
-        else
-          {
-            int error(delta_x - (delta_y >> 1));
-
-            while (py != y)
-              {
-                if ((error > 0) || (!error && (iy > 0)))
-                  {
-                    error -= delta_y;
-                    px += ix;
-                  }
-
-                error += delta_x;
-                py += iy;
-
-                if (!abroad(px, py))
-                  {
-                    source_set_detected(px, py);
-                    render_set_visible(px, py);
-                    if (!viewer.visible(m_source->at(px, py).symbol))
-                      goto next_line;
-                  }
-              }
-          }
-        next_line: ;
+        const tile_mask &visible = m_fovs[e.handle[i].index].visible;
+        if (visible.width() <= 0 || visible.height() <= 0)
+          continue;
+
+        x0 = std::min(x0, visible.x());
+        y0 = std::min(y0, visible.y());
+        x1 = std::max(x1, visible.x() + visible.width());
+        y1 = std::max(y1, visible.y() + visible.height());
+        merge |= changed[i];
       }
+
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::max(std::min(x1, width()), x0);
+  y1 = std::max(std::min(y1, height()), y0);
+
+  merge |= m_seen.x() != x0 || m_seen.y() != y0 || m_seen.width() != x1 - x0 || m_seen.height() != y1 - y0;
+  if (!merge)
+    return false;
+
+  m_seen.reset(x0, y0, x1 - x0, y1 - y0);
+  for (size_t i = 0; i < n; ++i)
+    if (shown(i))
+      m_fovs[e.handle[i].index].visible.for_each([&](int x, int y) {
+          if (lit(e.x[i], e.y[i], x, y))
+            m_seen.set(x, y);
+        });
+
+  return true;
+}
+
+bool scenario::sees(const object &viewer, int x, int y) const
+{
+  uint32_t i = viewer.entity().index;
+  if (i >= m_fovs.size())
+    return false;
+
+  const tile_mask &visible = m_fovs[i].visible;
+  return m_fovs[i].valid && visible.contains(x, y) && visible.test(x, y) && lit(viewer.x(), viewer.y(), x, y);
+}
+
+/* Lines of sight through the tiles the player cannot see through */
+bool scenario::los(int x0, int y0, int x1, int y1) const
+{ return los(m_entities.type[entity_at(m_entities, m_player->entity())], x0, y0, x1, y1); }
+
+void scenario::los(const vector<fov_line> &lines, vector<char> &seen) const
+{ los(m_entities.type[entity_at(m_entities, m_player->entity())], lines, seen); }
+
+/* Lines of sight through the tiles the viewer type cannot see through,
+ * remembered until the next turn or the next change of the map */
+bool scenario::los(size_t viewer, int x0, int y0, int x1, int y1) const
+{
+  vector<char> seen;
+  los(viewer, {{x0, y0, x1, y1}}, seen);
+  return seen.front();
+}
+
+void scenario::los(size_t viewer, const vector<fov_line> &lines, vector<char> &seen) const
+{
+  if (m_los_changes != m_source->changes().end())
+    {
+      m_los.clear();
+      m_los_changes = m_source->changes().end();
+    }
+
+  seen.resize(lines.size());
+
+  vector<fov_line> unknown;
+  vector<size_t>   where;
+  for (size_t i = 0; i < lines.size(); ++i)
+    {
+      /* Nothing is seen off the map */
+      const fov_line &l = lines[i];
+      if (abroad(l.x0, l.y0) || abroad(l.x1, l.y1))
+        {
+          seen[i] = false;
+          continue;
+        }
+
+      auto known = m_los.find({viewer, l});
+      if (known != m_los.end())
+        seen[i] = known->second;
+      else
+        {
+          unknown.push_back(lines[i]);
+          where.push_back(i);
+        }
+    }
+
+  if (unknown.empty())
+    return;
+
+  vector<char> found;
+  const object_type &type = *m_types[viewer];
+  fov_los(unknown, found, [&](int x, int y) { return opaque(type, x, y); });
+
+  for (size_t i = 0; i < unknown.size(); ++i)
+    {
+      seen[where[i]] = found[i];
+      m_los.emplace(los_query{viewer, unknown[i]}, found[i]);
+    }
+}
+
+/* Both fields of view of the player from every tile they can stand on */
+string scenario::fov_compare() const
+{
+  using clock = std::chrono::steady_clock;
+
+  const object &viewer = *m_player;
+  int r = viewer.vision_range();
+
+  auto opaque = [&](int x, int y) { return this->opaque(viewer.type(), x, y); };
+
+  tile_mask rays, shadow;
+  long positions = 0, only_rays = 0, only_shadow = 0, seen = 0;
+  clock::duration rays_time{}, shadow_time{};
+
+  for (int y = 0; y < height(); ++y)
+    for (int x = 0; x < width(); ++x)
+      {
+        if (!viewer.movable(m_source->at(x, y).symbol))
+          continue;
+
+        ++positions;
+        rays.reset(x - r, y - r, r * 2, r * 2);
+        shadow.reset(x - r, y - r, r * 2, r * 2);
+
+        auto start = clock::now();
+        fov_rays(x, y, r, opaque, [&](int tx, int ty) { if (!abroad(tx, ty)) rays.set(tx, ty); });
+        auto middle = clock::now();
+        fov_compute(x, y, r, opaque, [&](int tx, int ty) { if (!abroad(tx, ty)) shadow.set(tx, ty); });
+        auto end = clock::now();
+
+        rays_time   += middle - start;
+        shadow_time += end - middle;
+
+        rays.for_each([&](int tx, int ty) { ++seen; only_rays += !shadow.test(tx, ty); });
+        shadow.for_each([&](int tx, int ty) { only_shadow += !rays.test(tx, ty); });
+      }
+
+  auto us = [](clock::duration d) {
+      return to_string(std::chrono::duration_cast<std::chrono::microseconds>(d).count()) + "us";
+    };
+
+  return "positions " + to_string(positions) + " range " + to_string(r) +
+         " seen " + to_string(seen) + " only-rays " + to_string(only_rays) +
+         " only-shadow " + to_string(only_shadow) +
+         " rays " + us(rays_time) + " shadow " + us(shadow_time) + "\n";
 }
 
 void scenario::turn()
 {
+  m_los.clear();
+
   /* At first rendered map of the new state,
      * and then later checked
      * events and pop-up windows */
   render();
+  trim_changes();
 
   for (auto &event : m_events)
     {
@@ -274,30 +562,235 @@ void scenario::turn()
     }
 }
 
+/* The grid of the tiles the type can step on, made on the first use */
+path_grid& scenario::path_grid_of(size_t type)
+{
+  if (m_path_grids.size() < m_types.size())
+    m_path_grids.resize(m_types.size());
+
+  const object_type &t = *m_types[type];
+  auto passable = [&](int x, int y) { return t.movable(m_source->at(x, y).symbol); };
+
+  path_grid &grid = m_path_grids[type];
+  if (grid.open.empty())
+    path_grid_reset(grid, width(), height(), m_source->changes(), passable);
+  else
+    path_grid_update(grid, m_source->changes(), passable);
+  return grid;
+}
+
+/* Drop the map changes all the fields of view, lights and path grids have looked at */
+void scenario::trim_changes()
+{
+  auto &changes = m_source->changes();
+  if (changes.tiles.empty())
+    return;
+
+  size_t upto = changes.end();
+  for (auto &fov : m_fovs)
+    if (fov.valid)
+      upto = std::min(upto, fov.changes);
+
+  if (m_source->dark())
+    {
+      upto = std::min(upto, m_light_changes);
+      for (auto &s : m_light.sources)
+        if (s.radius > 0 && s.fov.valid)
+          upto = std::min(upto, s.fov.changes);
+    }
+
+  for (size_t type = 0; type < m_path_grids.size(); ++type)
+    if (!m_path_grids[type].open.empty())
+      path_grid_of(type);
+
+  m_source->trim_changes(upto);
+}
+
+/* Put the symbol on the tile (x, y) of the map */
+void scenario::set_tile(int x, int y, glyph_t symbol)
+{
+  if (abroad(x, y) || m_source->at(x, y).symbol == symbol)
+    return;
+
+  m_source->set_symbol(x, y, symbol);
+}
+
+/* One step of the object along the shortest path to (x, y) */
+void scenario::walk(object &o, int x, int y)
+{
+  if (abroad(x, y) || (o.x() == x && o.y() == y))
+    return;
+
+  auto &changes = m_source->changes();
+  path_grid &grid = path_grid_of(m_entities.type[entity_at(m_entities, o.entity())]);
+
+  size_t i = o.entity().index;
+  if (m_walks.size() <= i)
+    m_walks.resize(i + 1);
+
+  /* A goal that cannot be reached is not searched again until something changes */
+  walk_plan &plan = m_walks[i];
+  if (plan.goal.x != x || plan.goal.y != y || plan.changes != changes.end() ||
+      plan.from.x != o.x() || plan.from.y != o.y())
+    {
+      plan.goal = {x, y};
+      plan.from = {o.x(), o.y()};
+      plan.changes = changes.end();
+      plan.step = 0;
+      if (!path_jps(m_path, grid, o.x(), o.y(), x, y, plan.tiles))
+        plan.tiles.clear();
+    }
+
+  if (plan.step >= plan.tiles.size())
+    return;
+
+  tile_pos next = plan.tiles[plan.step];
+  if (o.move(next.x - o.x(), next.y - o.y(), m_source->at(next.x, next.y).symbol))
+    {
+      plan.from = next;
+      ++plan.step;
+    }
+}
+
+/* Copy the visible part of the map with a margin into the viewport buffer,
+ * which is allocated only when the terminal size changes */
+void scenario::render_view()
+{
+  int view_w = m_cols + DEFAULT_VIEW_MARGIN * 2;
+  int view_h = m_lines + DEFAULT_VIEW_MARGIN * 2;
+
+  if (m_view.size() != size_t(view_h) || m_view.front().lenght != size_t(view_w))
+    m_view.assign(size_t(view_h), text(string(size_t(view_w), ' ')));
+
+  m_view_x = x() - DEFAULT_VIEW_MARGIN;
+  m_view_y = y() - DEFAULT_VIEW_MARGIN;
+
+  /* Part of the viewport that lies on the map */
+  int xbegin = std::max(m_view_x, 0);
+  int xend   = std::min(m_view_x + view_w, width());
+
+  for (int i = 0; i < view_h; ++i)
+    {
+      cchar *row = m_view[size_t(i)].cstr;
+      int my = m_view_y + i;
+
+      for (int j = 0; j < view_w; ++j)
+        row[j] = cchar{' ', A_INVIS};
+
+      if (abroady(my) || xbegin >= xend)
+        continue;
+
+      const cchar *line = m_source->get_map()[size_t(my)].cstr;
+      std::copy(line + xbegin, line + xend, row + (xbegin - m_view_x));
+    }
+}
+
 void scenario::render()
 { 
-  m_render.reset(new character_map(*m_source));
+  render_view();
+
+  /* Panning the view or standing still does not change what is seen */
+  if (render_fov())
+    source_set_detected();
+  render_set_visible();
 
-  render_los(*m_player->get());
+  int view_w = m_cols + DEFAULT_VIEW_MARGIN * 2;
+  int view_h = m_lines + DEFAULT_VIEW_MARGIN * 2;
 
-  for (auto& obj : m_objects)
+  /* Only the objects in the view, in the order of their entities */
+  spatial_rect(m_spatial, m_view_x, m_view_y, view_w, view_h, m_found);
+  for (auto i : m_found)
     {
-      auto &tile = m_render->at(obj->x(), obj->y());
-      tile.symbol = obj->symbol().symbol;
+      size_t d = m_entities.dense[i];
+      int ox = m_entities.x[d] - m_view_x;
+      int oy = m_entities.y[d] - m_view_y;
+
+      auto &tile = m_view[size_t(oy)].cstr[ox];
+      const cchar &symbol = m_entities.symbol[d];
+      tile.symbol = symbol.symbol;
       tile.attribute &= ~COLOR_PAIR( PAIR_NUMBER(tile.attribute) );
-      tile.attribute |=  COLOR_PAIR( PAIR_NUMBER(obj->symbol().attribute) );
+      tile.attribute |=  COLOR_PAIR( PAIR_NUMBER(symbol.attribute) );
     }
-  m_render_f(m_render->get_map(), x(), y());
+
+  render_animated();
+  m_render_f(m_view, DEFAULT_VIEW_MARGIN, DEFAULT_VIEW_MARGIN, x(), y(), nullptr);
 }
 
-objects::const_iterator scenario::find_object(const string& id) const
+/* Find the animated tiles shown on the screen and give them the current look */
+void scenario::render_animated()
 {
-  for (auto iter = m_objects.begin(); iter != m_objects.end(); ++iter)
+  int view_w = m_cols + DEFAULT_VIEW_MARGIN * 2;
+  int view_h = m_lines + DEFAULT_VIEW_MARGIN * 2;
+
+  m_animated.clear();
+
+  for (int i = DEFAULT_VIEW_MARGIN; i < view_h - DEFAULT_VIEW_MARGIN; ++i)
     {
-      if ((*iter)->id() == id)
-        return iter;
+      int my = m_view_y + i;
+      if (abroady(my))
+        continue;
+
+      int jbegin = std::max(DEFAULT_VIEW_MARGIN, -m_view_x);
+      int jend   = std::min(view_w - DEFAULT_VIEW_MARGIN, width() - m_view_x);
+
+      const cchar *line = m_source->get_map()[size_t(my)].cstr + m_view_x;
+      cchar *row = m_view[size_t(i)].cstr;
+
+      for (int j = jbegin; j < jend; ++j)
+        {
+          /* Covered by an object or not seen yet */
+          if (row[j].symbol != line[j].symbol || row[j].attribute & A_INVIS)
+            continue;
+
+          if (character_map::animation(line[j].symbol))
+            m_animated.push_back(i * view_w + j);
+        }
     }
-  return m_objects.end();
+
+  render_looks();
+}
+
+void scenario::render_looks()
+{
+  int view_w = m_cols + DEFAULT_VIEW_MARGIN * 2;
+
+  for (int c : m_animated)
+    {
+      int i = c / view_w, j = c % view_w;
+      int mx = m_view_x + j, my = m_view_y + i;
+
+      auto looks = character_map::animation(m_source->at(mx, my).symbol);
+      const cchar &look = (*looks)[(m_tick + unsigned(mx + my)) % looks->size()];
+
+      auto &tile = m_view[size_t(i)].cstr[j];
+      tile.symbol = look.symbol;
+      tile.attribute &= ~COLOR_PAIR( PAIR_NUMBER(tile.attribute) );
+      tile.attribute |=  COLOR_PAIR( PAIR_NUMBER(look.attribute) );
+    }
+}
+
+/* Only the animated tiles change: the turn is not replayed
+ * and only their cells are shown again */
+void scenario::tick()
+{
+  ++m_tick;
+
+  if (m_animated.empty())
+    return;
+
+  /* The view may have been moved since m_view was composed,
+   * the animated tiles are shown where they were composed */
+  render_looks();
+  m_render_f(m_view, DEFAULT_VIEW_MARGIN, DEFAULT_VIEW_MARGIN,
+             m_view_x + DEFAULT_VIEW_MARGIN, m_view_y + DEFAULT_VIEW_MARGIN, &m_animated);
+}
+
+objects::const_iterator scenario::find_object(const string& id) const
+{
+  auto found = m_object_ids.find(id);
+  if (found == m_object_ids.end())
+    return m_objects.end();
+  return m_objects.begin() + long(found->second);
 }
 
 events::const_iterator scenario::find_event(const string& id) const
@@ -354,6 +847,33 @@ bool scenario::parse_condition(const string& cond) const
     {
       if (id == RESERVED_SCENARIO_ID)
         {
+          if (method == "los")
+            {
+              istringstream in(args);
+              int x0, y0, x1, y1;
+              if (in >> x0 >> y0 >> x1 >> y1)
+                return los(x0, y0, x1, y1);
+            }
+          else if (method == "at")
+            {
+              /* Any object on the tile */
+              vector<size_t> found;
+              istringstream in(args);
+              int x, y;
+              if (in >> x >> y)
+                spatial_at(m_spatial, x, y, found);
+              return !found.empty();
+            }
+          else if (method == "in")
+            {
+              /* Any object in the rectangle */
+              vector<size_t> found;
+              istringstream in(args);
+              int x, y, w, h;
+              if (in >> x >> y >> w >> h)
+                spatial_rect(m_spatial, x, y, w, h, found);
+              return !found.empty();
+            }
 
           return false;
         }
@@ -371,6 +891,47 @@ bool scenario::parse_condition(const string& cond) const
                   y == (*object)->y())
                 return true;
             }
+          else if (method == "sees")
+            {
+              /* A tile or another object */
+              auto target = find_object(args);
+              if (target != m_objects.end())
+                return sees(**object, (*target)->x(), (*target)->y());
+
+              istringstream in(args);
+              int x;
+              int y;
+              if (in >> x >> y)
+                return sees(**object, x, y);
+            }
+          else if (method == "los")
+            {
+              /* A line of sight to the tile through what the type of the object sees through */
+              istringstream in(args);
+              int x;
+              int y;
+              if (in >> x >> y)
+                return los(m_entities.type[entity_at(m_entities, (*object)->entity())],
+                           (*object)->x(), (*object)->y(), x, y);
+            }
+          else if (method == "near")
+            {
+              /* Another object within the range */
+              istringstream in(args);
+              long range;
+              if (!(in >> range))
+                return false;
+
+              size_t self = (*object)->entity().index;
+              size_t other = spatial_nearest(m_spatial, (*object)->x(), (*object)->y(), self);
+              if (other == SPATIAL_NONE)
+                return false;
+
+              size_t d = m_entities.dense[other];
+              long dx = m_entities.x[d] - (*object)->x();
+              long dy = m_entities.y[d] - (*object)->y();
+              return dx * dx + dy * dy <= range * range;
+            }
 
           return false;
         }
@@ -380,9 +941,9 @@ bool scenario::parse_condition(const string& cond) const
         {
           if (method == "happened") {
               if (args.empty())
-                return event->get()->happened();
+                return (*event)->happened();
               else
-                return event->get()->happened(stoi(args));
+                return (*event)->happened(stoi(args));
             }
 
           return false;
@@ -407,6 +968,21 @@ void scenario::parse_command(const string& comm)
           if (method == "exit")
             window_set(BUILD_MAIN);
 
+          else if (method == "set")
+            {
+              /* The tile and its new symbol */
+              istringstream in(args);
+              int x;
+              int y;
+              string symbol;
+              if (in >> x >> y >> symbol)
+                {
+                  auto glyphs = glyph_string(symbol);
+                  if (glyphs.size() == 1)
+                    set_tile(x, y, glyphs.front());
+                }
+            }
+
           return;
         }
       else if (id == RESERVED_DIALOG_ID)
@@ -420,7 +996,14 @@ void scenario::parse_command(const string& comm)
       auto object = find_object(id);
       if (object != m_objects.end())
         {
-
+          if (method == "goto")
+            {
+              istringstream in(args);
+              int x;
+              int y;
+              if (in >> x >> y)
+                walk(**object, x, y);
+            }
           return;
         }
 
@@ -562,16 +1145,19 @@ void scenario::parse_yaml() {
     if (not (node and node->type == YAML_MAPPING_NODE))
       throw game_error(DEFAULT_PARSE_ERROR);
 
-    for (auto pair = node->data.mapping.pairs.start;
-         pair < node->data.mapping.pairs.top; ++pair)
-      {
-        auto section = yaml_document_get_node(&document, pair->key);
-        if (section->type != YAML_SCALAR_NODE) throw game_error(DEFAULT_PARSE_ERROR);
-        const char *key = reinterpret_cast<const char *>(section->data.scalar.value);
-        parse_yaml(key, yaml_document_get_node(&document, pair->value), &document);
-      }
+    /* The types first, the objects refer to them */
+    for (bool types : {true, false})
+      for (auto pair = node->data.mapping.pairs.start;
+           pair < node->data.mapping.pairs.top; ++pair)
+        {
+          auto section = yaml_document_get_node(&document, pair->key);
+          if (section->type != YAML_SCALAR_NODE) throw game_error(DEFAULT_PARSE_ERROR);
+          const char *key = reinterpret_cast<const char *>(section->data.scalar.value);
+          if (types == !strcmp(key, YAML_SECTION_TYPES))
+            parse_yaml(key, yaml_document_get_node(&document, pair->value), &document);
+        }
 
-    if (m_player == m_objects.end())
+    if (!m_player)
       throw game_error("Player structure doesn't exists.");
 
     yaml_document_delete(&document);
@@ -597,17 +1183,36 @@ void scenario::parse_yaml(const char *section_type, const yaml_node_t *node, yam
 
       const char *key = reinterpret_cast<const char *>(node_key->data.scalar.value);
 
-      if (!strcmp(section_type, YAML_SECTION_OBJECTS))
+      if (!strcmp(section_type, YAML_SECTION_TYPES))
+        {
+          /* Type names are not identifiers of the scenario */
+          for (auto &type : m_types)
+            if (type->id() == key)
+              throw game_error(string("Found identical types \"") + key + "\".");
+
+          if (m_types.size() > UINT16_MAX)
+            throw game_error("Too many object types.");
+
+          m_types.push_back(&object_type::create_from_yaml(m_arena, key, node_value, doc));
+          continue;
+        }
+      else if (!strcmp(section_type, YAML_SECTION_OBJECTS))
         {
-          m_objects.emplace_back(&object::create_from_yaml(key, node_value, doc));
+          m_objects.push_back(&object::create_from_yaml(m_arena, m_entities, m_types, key, node_value, doc));
+
+          object &created = *m_objects.back();
+          spatial_insert(m_spatial, created.entity().index, created.x(), created.y());
+          created.index_in(&m_spatial);
+          m_object_ids.emplace(key, m_objects.size() - 1);
+
           if (!strcmp(key, DEFAULT_PLAYER_ID))
-            m_player = prev(m_objects.end());
+            m_player = &created;
         }
       else if (!strcmp(section_type, YAML_SECTION_MAPS))
-        m_source.reset(&character_map::create_from_yaml(key, node_value, doc));
+        m_source = &character_map::create_from_yaml(m_arena, key, node_value, doc);
 
       else if (!strcmp(section_type, YAML_SECTION_EVENTS))
-        m_events.emplace_back(&event::create_from_yaml(key, node_value, doc));
+        m_events.push_back(&event::create_from_yaml(m_arena, key, node_value, doc));
       else
         throw game_error( string("Found unknown structure \"") + section_type + "\".");
 
@@ -624,11 +1229,35 @@ void scenario::add_id(const string &id)
 }
 
 void scenario_create_from_config(const string &f, render_f r_f, int l, int c)
-{ single_scenario.reset(new scenario(f, r_f, l, c)); }
+{
+  /* The former scenario stays when the new one fails to load */
+  unique_ptr<scenario> created(new scenario(f, r_f, l, c));
+  single_scenario = std::move(created);
+}
 
 void scenario_render()
 { if (single_scenario.get()) single_scenario->render(); }
 
+string scenario_export_image()
+{ return single_scenario.get() ? single_scenario->export_image() : string(); }
+
+string scenario_fov_compare()
+{ return single_scenario.get() ? single_scenario->fov_compare() : string(); }
+
+bool scenario_los(int x0, int y0, int x1, int y1)
+{ return single_scenario.get() && single_scenario->los(x0, y0, x1, y1); }
+
+void scenario_los(const vector<fov_line> &lines, vector<char> &seen)
+{
+  if (single_scenario.get())
+    single_scenario->los(lines, seen);
+  else
+    seen.assign(lines.size(), false);
+}
+
+void scenario_animate(arg_t)
+{ if (single_scenario.get()) single_scenario->tick(); }
+
 void scenario_set_view_x(arg_t arg)
 { if (single_scenario.get()) single_scenario->set_view(int(arg), 0); }
 
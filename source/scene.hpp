@@ -18,12 +18,29 @@
 #define SCENE_HPP
 
 #include "event.hpp"
+#include "fov.hpp"
 
-using render_f = void (*)(const vector<text> &m, int x, int y);
+/* Show m starting from the cell (x, y), which is the map tile (view_x, view_y).
+ * If cells is not null, only the listed cells of m (line * width + column) changed */
+using render_f = void (*)(const vector<text> &m, int x, int y, int view_x, int view_y,
+                          const vector<int> *cells);
 
 /* Reset current sceanrio if it exists */
 void scenario_create_from_config(const string &, render_f r_f, int l, int c);
 void scenario_render();
+/* Show the next look of the animated tiles in view */
+void scenario_animate(arg_t);
+/* The file name of the exported map with the explored overlay */
+string scenario_export_image();
+
+/* The shadowcasting field of view against the former rays, over the whole map */
+string scenario_fov_compare();
+
+/* Lines of sight through the tiles the player cannot see through, no line
+ * with an end off the map is seen. The answers are kept until the next
+ * turn or change of the map */
+bool scenario_los(int x0, int y0, int x1, int y1);
+void scenario_los(const vector<fov_line> &lines, vector<char> &seen);
 void scenario_set_view_x(arg_t);
 void scenario_set_view_y(arg_t);
 void scenario_move_view_x(arg_t);
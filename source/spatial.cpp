@@ -0,0 +1,172 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "spatial.hpp"
+
+static uint64_t bucket_key(int bx, int by)
+{ return uint64_t(uint32_t(bx)) << 32 | uint64_t(uint32_t(by)); }
+
+static const vector<spatial_entry> *bucket(const spatial_hash &h, int bx, int by)
+{
+  auto found = h.buckets.find(bucket_key(bx, by));
+  return found == h.buckets.end()? nullptr : &found->second;
+}
+
+void spatial_insert(spatial_hash &h, size_t id, int x, int y)
+{
+  int bx = x >> SPATIAL_BUCKET_SHIFT;
+  int by = y >> SPATIAL_BUCKET_SHIFT;
+
+  if (h.bx1 < h.bx0)
+    {
+      h.bx0 = h.bx1 = bx;
+      h.by0 = h.by1 = by;
+    }
+  h.bx0 = std::min(h.bx0, bx);
+  h.by0 = std::min(h.by0, by);
+  h.bx1 = std::max(h.bx1, bx);
+  h.by1 = std::max(h.by1, by);
+
+  h.buckets[bucket_key(bx, by)].push_back({id, x, y});
+}
+
+void spatial_erase(spatial_hash &h, size_t id, int x, int y)
+{
+  auto found = h.buckets.find(bucket_key(x >> SPATIAL_BUCKET_SHIFT, y >> SPATIAL_BUCKET_SHIFT));
+  if (found == h.buckets.end())
+    return;
+
+  auto &entries = found->second;
+  for (size_t i = 0; i < entries.size(); ++i)
+    if (entries[i].id == id)
+      {
+        entries[i] = entries.back();
+        entries.pop_back();
+        break;
+      }
+
+  if (entries.empty())
+    h.buckets.erase(found);
+}
+
+void spatial_move(spatial_hash &h, size_t id, int x0, int y0, int x1, int y1)
+{
+  /* Within a bucket only the place changes */
+  if (x0 >> SPATIAL_BUCKET_SHIFT == x1 >> SPATIAL_BUCKET_SHIFT &&
+      y0 >> SPATIAL_BUCKET_SHIFT == y1 >> SPATIAL_BUCKET_SHIFT)
+    {
+      auto found = h.buckets.find(bucket_key(x0 >> SPATIAL_BUCKET_SHIFT, y0 >> SPATIAL_BUCKET_SHIFT));
+      if (found != h.buckets.end())
+        for (auto &entry : found->second)
+          if (entry.id == id)
+            {
+              entry.x = x1;
+              entry.y = y1;
+              return;
+            }
+    }
+
+  spatial_erase(h, id, x0, y0);
+  spatial_insert(h, id, x1, y1);
+}
+
+void spatial_at(const spatial_hash &h, int x, int y, vector<size_t> &found)
+{ spatial_rect(h, x, y, 1, 1, found); }
+
+void spatial_rect(const spatial_hash &h, int x, int y, int w, int ht, vector<size_t> &found)
+{
+  found.clear();
+  if (w <= 0 || ht <= 0)
+    return;
+
+  int bx0 = std::max(x >> SPATIAL_BUCKET_SHIFT, h.bx0);
+  int by0 = std::max(y >> SPATIAL_BUCKET_SHIFT, h.by0);
+  int bx1 = std::min((x + w - 1) >> SPATIAL_BUCKET_SHIFT, h.bx1);
+  int by1 = std::min((y + ht - 1) >> SPATIAL_BUCKET_SHIFT, h.by1);
+
+  for (int by = by0; by <= by1; ++by)
+    for (int bx = bx0; bx <= bx1; ++bx)
+      if (auto entries = bucket(h, bx, by))
+        for (auto &entry : *entries)
+          if (entry.x >= x && entry.y >= y && entry.x < x + w && entry.y < y + ht)
+            found.push_back(entry.id);
+
+  std::sort(found.begin(), found.end());
+}
+
+size_t spatial_nearest(const spatial_hash &h, int x, int y, size_t skip)
+{
+  int bx = x >> SPATIAL_BUCKET_SHIFT;
+  int by = y >> SPATIAL_BUCKET_SHIFT;
+
+  /* The ring beyond which no bucket was used */
+  int last = std::max(std::max(bx - h.bx0, h.bx1 - bx), std::max(by - h.by0, h.by1 - by));
+
+  size_t best = SPATIAL_NONE;
+  long   best_distance = 0;
+
+  auto look = [&](int cx, int cy) {
+      if (auto entries = bucket(h, cx, cy))
+        for (auto &entry : *entries)
+          {
+            if (entry.id == skip)
+              continue;
+
+            long dx = entry.x - x;
+            long dy = entry.y - y;
+            long distance = dx * dx + dy * dy;
+
+            if (best == SPATIAL_NONE || distance < best_distance ||
+                (distance == best_distance && entry.id < best))
+              {
+                best = entry.id;
+                best_distance = distance;
+              }
+          }
+    };
+
+  for (int ring = 0; ring <= last; ++ring)
+    {
+      /* The tiles of this ring are at least that far along one axis */
+      if (ring > 0 && best != SPATIAL_NONE)
+        {
+          long reach = long(ring - 1) * SPATIAL_BUCKET + 1;
+          if (reach * reach > best_distance)
+            break;
+        }
+
+      if (ring == 0)
+        {
+          look(bx, by);
+          continue;
+        }
+
+      for (int i = -ring; i <= ring; ++i)
+        {
+          look(bx + i, by - ring);
+          look(bx + i, by + ring);
+        }
+      for (int i = -ring + 1; i < ring; ++i)
+        {
+          look(bx - ring, by + i);
+          look(bx + ring, by + i);
+        }
+    }
+
+  return best;
+}
@@ -0,0 +1,67 @@
+/* This file is part of Walker.
+ *
+ * Walker is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Walker is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Walker.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPATIAL_HPP
+#define SPATIAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using std::vector;
+
+/* Tiles of a bucket along each axis, as a power of two */
+#define SPATIAL_BUCKET_SHIFT 3
+#define SPATIAL_BUCKET       (1 << SPATIAL_BUCKET_SHIFT)
+
+/* No thing found */
+#define SPATIAL_NONE SIZE_MAX
+
+struct spatial_entry
+{
+  size_t id;
+  int    x;
+  int    y;
+};
+
+/* Things standing on the tiles, by their ids, kept in square buckets
+ * of tiles so that a query looks only at the buckets it covers */
+struct spatial_hash
+{
+  std::unordered_map<uint64_t, vector<spatial_entry>> buckets;
+
+  /* Buckets ever used, to know where to stop looking */
+  int bx0 = 0, by0 = 0;
+  int bx1 = -1, by1 = -1;
+};
+
+void spatial_insert(spatial_hash &h, size_t id, int x, int y);
+void spatial_erase(spatial_hash &h, size_t id, int x, int y);
+
+/* The thing has moved from (x0, y0) to (x1, y1) */
+void spatial_move(spatial_hash &h, size_t id, int x0, int y0, int x1, int y1);
+
+/* Ids of the things on a tile or in a w x h rectangle, in increasing order */
+void spatial_at(const spatial_hash &h, int x, int y, vector<size_t> &found);
+void spatial_rect(const spatial_hash &h, int x, int y, int w, int ht, vector<size_t> &found);
+
+/* The thing closest to (x, y) other than skip, the one with the lowest id
+ * of those equally close, or SPATIAL_NONE. The buckets are looked at in
+ * rings around (x, y) until no closer thing can be found */
+size_t spatial_nearest(const spatial_hash &h, int x, int y, size_t skip = SPATIAL_NONE);
+
+#endif // SPATIAL_HPP
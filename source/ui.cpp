@@ -29,6 +29,7 @@ using std::unique_ptr;
 static void map_generate(arg_t);
 static void scenario_menu();
 static void scenario_init(arg_t);
+static void map_export();
 
 static item menu_main[] =
 {
@@ -88,6 +89,8 @@ static hook hooks_main[] =
   hook(KEY_DOWN, {fun_t(window_menu_driver), REQ_DOWN_ITEM}),
   hook(KEY_UP,   {fun_t(window_menu_driver), REQ_UP_ITEM}),
   hook('\n',     {fun_t(window_menu_driver), REQ_EXEC_ITEM}),
+  hook(KEY_NPAGE, {fun_t(window_text_scroll),  1}),
+  hook(KEY_PPAGE, {fun_t(window_text_scroll), -1}),
   {0, {nullptr, 0}}
 };
 
@@ -95,6 +98,10 @@ static hook hooks_game[] =
 {
   hook('Q',       {window_push, BUILD_GAME_MENU}),
   hook('q',       {window_push, BUILD_GAME_MENU}),
+  hook('e',       {fun_t(map_export), 0}),
+
+  // Animated tiles
+  hook(ERR,       {scenario_animate, 0}),
 
   // Player moving
   hook(KEY_DOWN,  {scenario_move_player_y,  1}),
@@ -121,6 +128,8 @@ static hook hooks_menu[] =
   hook(KEY_DOWN, {fun_t(window_menu_driver), REQ_DOWN_ITEM}),
   hook(KEY_UP,   {fun_t(window_menu_driver), REQ_UP_ITEM}),
   hook('\n',     {fun_t(window_menu_driver), REQ_EXEC_ITEM}),
+  hook(KEY_NPAGE, {fun_t(window_text_scroll),  1}),
+  hook(KEY_PPAGE, {fun_t(window_text_scroll), -1}),
   {0, {nullptr, 0}}
 };
 
@@ -150,14 +159,20 @@ const static text descs[] =
   text("General", PAIR(NEUTRAL_COLOR, COLOR_BLACK)|A_BOLD) + ":\n\
   Q/q      - Close the window (not the main menu).\n\
   Enter    - Choosing.\n\
-  Up, Down - Menu navigation.\n\n" +
+  Up, Down - Menu navigation.\n\
+  PgUp, PgDn - Scroll a long text.\n\n" +
   text("Game", PAIR(NEUTRAL_COLOR, COLOR_BLACK)|A_BOLD) + ":\n\
   i/I, j/J, k/K, l/L    - Map view moving.\n\
   Up, Down, Right, Left - Player moving.\n\
   Q/q                   - Open game menu.\n\
+  e                     - Export the explored map as an image.\n\
   Enter                 - Close the message window.",
 };
 
+/* The windows refer to the descriptions, which are laid out once
+ * for the size of the terminal */
+static text_layout desc_layouts[SIZE(descs)];
+
 const static text titles[] =
 {
   "Menu",
@@ -175,11 +190,13 @@ builder build[] =
   POSITION_FULL,
   menus[MENU_MAIN],
   hooks[HOOKS_MAIN],
-  descs[DESC_MAIN],
+  &descs[DESC_MAIN],
   titles[TITLE_MENU],
   OPTION_NORMAL,
   FORMAT_CENTER,
-  images[IMAGE_HORSEBACK_FIGHT]
+  images[IMAGE_HORSEBACK_FIGHT],
+  PAIR(NEUTRAL_COLOR, COLOR_BLACK),
+  &desc_layouts[DESC_MAIN]
   ),
 
   builder /* BUILD_GAME */
@@ -215,11 +232,13 @@ builder build[] =
   POSITION_FULL,
   menus[MENU_MAP_CREATOR],
   hooks[HOOKS_MENU],
-  descs[DESC_MAP_CREATOR],
+  &descs[DESC_MAP_CREATOR],
   titles[TITLE_MAP_CREATOR],
   OPTION_NORMAL,
   FORMAT_CENTER,
-  images[IMAGE_MOUNTAINS]
+  images[IMAGE_MOUNTAINS],
+  PAIR(NEUTRAL_COLOR, COLOR_BLACK),
+  &desc_layouts[DESC_MAP_CREATOR]
   ),
 
   builder /* BUILD_MAP_SIZES */
@@ -227,8 +246,13 @@ builder build[] =
   POSITION_SMALL,
   menus[MENU_MAP_SIZES],
   hooks[HOOKS_MENU],
-  descs[DESC_MAP_SIZES],
-  titles[TITLE_MAP_SIZES]
+  &descs[DESC_MAP_SIZES],
+  titles[TITLE_MAP_SIZES],
+  OPTION_NORMAL,
+  FORMAT_CENTER,
+  nullptr,
+  PAIR(NEUTRAL_COLOR, COLOR_BLACK),
+  &desc_layouts[DESC_MAP_SIZES]
   ),
 
   builder /* BUILD_ERROR */
@@ -245,10 +269,13 @@ builder build[] =
   POSITION_FULL,
   menus[MENU_BACK],
   hooks[HOOKS_MENU],
-  descs[DESC_CONTROL],
+  &descs[DESC_CONTROL],
   titles[TITLE_CONTROL],
   OPTION_NORMAL,
-  FORMAT_RIGHT
+  FORMAT_RIGHT,
+  nullptr,
+  PAIR(NEUTRAL_COLOR, COLOR_BLACK),
+  &desc_layouts[DESC_CONTROL]
   ),
 };
 
@@ -288,6 +315,21 @@ void map_generate(arg_t arg)
   window_push(BUILD_OKAY, "Map was successfully generated to " + fil);
 }
 
+void map_export()
+{
+  string fil;
+
+  try {
+    fil = scenario_export_image();
+
+  } catch (const game_error& error) {
+    window_push(BUILD_ERROR, error.what());
+    return;
+  }
+
+  window_push(BUILD_OKAY, "Map was successfully exported to " + fil);
+}
+
 void scenario_menu()
 {
   constexpr size_t extension_size = sizeof(".yaml");
@@ -23,7 +23,10 @@
 #include <ncurses.h>
 #include <stdexcept>
 
+#include "glyph.hpp"
+
 #define SIZE(x) (sizeof(x)/sizeof(x[0]))
+/* Pair of two basic colors, color_pair() makes any other */
 #define PAIR(A, B) COLOR_PAIR(B*8 + (A + 1))
 
 #define COLOR_BLACK   0
@@ -64,7 +67,7 @@ struct action
 
 struct cchar
 {
-    char symbol;
+    glyph_t symbol;
     attr_t attribute;
 };
 
@@ -72,12 +75,14 @@ struct text
 {
   text() = default;
 
+  /* str is UTF-8, every symbol of it becomes one glyph */
   text(const char *str, attr_t attr) {
-    lenght = str? strlen(str) : 0;
+    size_t bytes = str? strlen(str) : 0;
+    lenght = glyph_count(str, bytes);
     cstr = reinterpret_cast<cchar *>(calloc(lenght, sizeof(cchar)));
-    
-    for (size_t i = 0; i < lenght; ++i) {
-        cstr[i].symbol    = str[i];
+
+    for (size_t i = 0, b = 0, n; i < lenght; ++i, b += n) {
+        cstr[i].symbol    = glyph_decode(str + b, &n);
         cstr[i].attribute = attr;
       }
   }
@@ -112,11 +117,11 @@ struct text
   text& operator+(const char *str)
   {
     auto pos = lenght;
-    lenght += strlen(str);
+    lenght += glyph_count(str, strlen(str));
     cstr =  reinterpret_cast<cchar *>(realloc(cstr, lenght * sizeof(cchar)));
-    for (auto i = pos; i < lenght; ++i)
+    for (size_t i = pos, b = 0, n; i < lenght; ++i, b += n)
       {
-        cstr[i].symbol = str[i - pos];
+        cstr[i].symbol = glyph_decode(str + b, &n);
         cstr[i].attribute = A_NORMAL;
       }
     return *this;
@@ -38,29 +38,36 @@
 #include <cmath>
 
 #include "window.hpp"
+#include "frame.hpp"
+#include "painter.hpp"
+#include "color.hpp"
 #include "utils.hpp"
 
 #define DESCRIPTION_HORIZONTAL_INTEND 1
 #define HORIZONTAL_INTEND 2
 #define VERTICAL_INTEND 2
 
+/* Milliseconds without keys before the ERR hook is called */
+#define HOOK_IDLE_TIMEOUT 200
+
 #define TITLE_SEPARATION " "
 #define ITEM_DESCRIPTION " "
 #define ITEM_SELECT " >>---> "
 
-static int text_height(const struct text *t, int freecols);
-static int waddtext(WINDOW *w, const struct text *t, format f);
+static int waddtext(WINDOW *w, const struct text *t);
+static int waddlayout(WINDOW *w, const struct text *t, const struct text_layout *l, int first);
 static int waddcchar(WINDOW *w, const struct cchar *t);
 
 static int items_count(const item *);
 static int hooks_count(const hook *);
 
 static int put_image(struct window *, const struct text *, int& nextline);
-static int put_text(struct window *, const struct text &, enum format, int& nextline);
+static int put_text(struct window *, const struct text *, enum format,
+                    struct text_layout *, int menu_lines, int& nextline);
 static int put_menu(struct window *, const struct item *, attr_t attribute, int& nextline);
 
-inline int mvwaddtext(WINDOW *w, int x, int y, const text *t, format f)
-{ return wmove(w,y,x) == ERR ? ERR : waddtext(w,t,f); }
+inline int mvwaddlayout(WINDOW *w, int x, int y, const text *t, const text_layout *l)
+{ return wmove(w,y,x) == ERR ? ERR : waddlayout(w,t,l,0); }
 
 struct window {
   PANEL  *panel;
@@ -77,10 +84,24 @@ struct window {
 
   enum position position;
   struct hook *hooks;
+
+  /* The text of sub_window_text and its layout: only the lines
+   * from first_line that fit into the window are drawn */
+  const struct text  *text;
+  struct text         own_text;
+  struct text_layout *layout;
+  struct text_layout  own_layout;
+  int                 first_line;
 };
 
 static struct window *top_window = nullptr;
 
+/* Cells of the map window and the window they were flushed to */
+static struct frame map_frame;
+static WINDOW *map_frame_window = nullptr;
+static int last_view_x, last_view_y;
+static enum output map_output = OUTPUT_CURSES;
+
 window *window_push(const struct builder &builder)
 {
   struct window *new_w = new window;  
@@ -100,11 +121,21 @@ window *window_push(const struct builder &builder)
   else
       new_w->sub_window_image = nullptr;
 
-  //int description_height = text_height(&builder.text, sub_window_width);
-  if (builder.text.lenght)
-      put_text(new_w, builder.text, builder.text_format, nextline);
+  const struct text *text = builder.text;
+  if (!text)
+    {
+      new_w->own_text = builder.own_text;
+      text = &new_w->own_text;
+    }
+
+  if (text->lenght)
+      put_text(new_w, text, builder.text_format, builder.layout,
+               builder.items ? items_count(builder.items) + 1 : 0, nextline);
   else
+    {
       new_w->sub_window_text = nullptr;
+      new_w->layout = nullptr;
+    }
 
   if (builder.items)
       put_menu(new_w, builder.items, builder.attribute, nextline);
@@ -116,7 +147,7 @@ window *window_push(const struct builder &builder)
   }
 
   /* Set window decorations */
-  wattron(new_w->window, builder.attribute);
+  wattron(new_w->window, color_curses(builder.attribute));
 
   if ( !(builder.options & OPTION_BORDERLESS))
        box(new_w->window, 0, 0);
@@ -127,17 +158,22 @@ window *window_push(const struct builder &builder)
       wattron(new_w->window, A_REVERSE);
       wmove(new_w->window, 0, loc_w.cols/2 - int(builder.title.lenght/2));
       waddstr(new_w->window, TITLE_SEPARATION);
-      waddtext(new_w->window, &builder.title, FORMAT_RIGHT);
+      waddtext(new_w->window, &builder.title);
       waddstr(new_w->window, TITLE_SEPARATION);
       wattroff(new_w->window, A_REVERSE);
     }
 
-  wattroff(new_w->window, builder.attribute);
+  wattroff(new_w->window, color_curses(builder.attribute));
 
   /* Set hooks */
   new_w->hooks   = builder.hooks;
   new_w->hooks_c = hooks_count(new_w->hooks);
 
+  /* ncurses does not know what the ANSI output put on the screen,
+   * so the area of the new window has to be painted completely */
+  if (map_output == OUTPUT_ANSI)
+    redrawwin(new_w->window);
+
   /* Panel creation */
   new_w->panel = new_panel(new_w->window);
   set_panel_userptr(new_w->panel, new_w);
@@ -172,6 +208,18 @@ void window_pop()
       free_item(top_window->items[n]);
     }
 
+  bool map_popped = top_window->sub_window_text == map_frame_window;
+
+  if (map_popped)
+    {
+      map_frame_window = nullptr;
+      if (map_output == OUTPUT_ANSI)
+        {
+          painter_cancel();
+          clearok(curscr, TRUE);
+        }
+    }
+
   delete [] top_window->items;
   del_panel(top_window->panel);
   delwin(top_window->sub_window_menu);
@@ -185,12 +233,29 @@ void window_pop()
 
   update_panels();
   window_refresh();
+
+  /* ncurses has just painted its own (empty) map window over the ANSI output */
+  if (map_output == OUTPUT_ANSI && top_window && !map_popped &&
+      top_window->sub_window_text == map_frame_window && map_frame_window)
+    {
+      if (painter_running())
+        painter_post(&map_frame, getbegy(map_frame_window), getbegx(map_frame_window),
+                     last_view_y, last_view_x, true);
+      else
+        {
+          frame_restore(&map_frame);
+          frame_flush_ansi(&map_frame, getbegy(map_frame_window), getbegx(map_frame_window));
+        }
+    }
 }
 
 void window_refresh()
 {
   if (!top_window) return;
 
+  /* ncurses and the painter must not write to the terminal together */
+  painter_sync();
+
   wnoutrefresh(top_window->sub_window_text);
   wnoutrefresh(top_window->sub_window_menu);
   wnoutrefresh(top_window->sub_window_image);
@@ -213,13 +278,34 @@ void window_menu_driver(int req)
   menu_driver(top_window->menu, req);
 
   auto item = reinterpret_cast<struct item *>(item_userptr(current_item(top_window->menu)));
-  wclear(top_window->sub_window_desc);
+  werase(top_window->sub_window_desc);
   if (item && item->description)
     mvwaddstr(top_window->sub_window_desc, 0, 0, item->description);
 
   window_refresh();
 }
 
+void window_text_scroll(int pages)
+{
+  if (!top_window || !top_window->layout || !top_window->sub_window_text)
+    return;
+
+  int height = getmaxy(top_window->sub_window_text);
+  int lines  = int(top_window->layout->lines.size());
+  int first  = top_window->first_line + pages * std::max(1, height - 1);
+
+  first = std::max(0, std::min(first, lines - height));
+  if (first == top_window->first_line)
+    return;
+
+  top_window->first_line = first;
+  werase(top_window->sub_window_text);
+  wmove(top_window->sub_window_text, 0, 0);
+  waddlayout(top_window->sub_window_text, top_window->text, top_window->layout, first);
+
+  window_refresh();
+}
+
 void window_hook()
 {
   if (!top_window) return;
@@ -227,6 +313,12 @@ void window_hook()
   struct hook *hks = top_window->hooks;
   int hks_c = top_window->hooks_c;
 
+  int delay = -1;
+  for (int i = 0; i < hks_c; ++i)
+    if (hks[i].key == ERR)
+      delay = HOOK_IDLE_TIMEOUT;
+  timeout(delay);
+
   int key = getch();
 
   /* Так как struct window хранит только указатель
@@ -237,15 +329,14 @@ void window_hook()
         hks[i].action();
 }
 
-void window_print(const vector<text> &vec, int x, int y)
+void window_print(const vector<text> &vec, int x, int y, int view_x, int view_y,
+                  const vector<int> *cells)
 {
   if (vec.empty() || !top_window) return;
   int text_h =
       top_window->sub_window_text? getmaxy(top_window->sub_window_text) -
                                    getbegy(top_window->sub_window_text) + 1 : 0;
   struct location loc_w = window_get_location();
-  int xend = x + loc_w.cols;
-  int yend = y + loc_w.lines;
 
   if (text_h != loc_w.lines)
     {
@@ -255,26 +346,57 @@ void window_print(const vector<text> &vec, int x, int y)
         top_window->sub_window_text = derwin(top_window->window, loc_w.lines, loc_w.cols, HORIZONTAL_INTEND, VERTICAL_INTEND);
     }
 
-  wmove(top_window->sub_window_text, 0, 0);
+  frame_resize(&map_frame, loc_w.lines, loc_w.cols);
 
-  int h = int(vec.size());
-  int w = int(vec.at(0).lenght);
-
-  /* Double array is limited to NULL "strcut text *" */
-  for (int i = y; i < yend; ++i)
-    for (int j = x; j < xend; ++j)
-      {
-        if (i >= h || j >= w)
-          {
-            waddch(top_window->sub_window_text, '\n');
-            break;
-          }
-        waddcchar(top_window->sub_window_text, &vec.at(size_t(i)).cstr[j]);
-      }
+  bool restore = map_frame_window != top_window->sub_window_text;
+  if (restore)
+    {
+      map_frame_window = top_window->sub_window_text;
+      frame_invalidate(&map_frame);
+    }
 
-  window_refresh();
+  /* The painter scrolls and compares by itself */
+  if (painter_running())
+    {
+      frame_compose(&map_frame, vec, x, y);
+      painter_post(&map_frame, getbegy(map_frame_window), getbegx(map_frame_window),
+                   view_y, view_x, restore);
+      last_view_x = view_x;
+      last_view_y = view_y;
+      return;
+    }
+
+  /* A one-step camera move scrolls what is already on the screen */
+  frame_scroll(&map_frame, view_y - last_view_y, view_x - last_view_x);
+  last_view_x = view_x;
+  last_view_y = view_y;
+
+  if (cells && !restore && !map_frame.invalid)
+    {
+      int w = int(vec.front().lenght);
+      for (int c : *cells)
+        {
+          int line = c / w - y, col = c % w - x;
+          if (line >= 0 && col >= 0 && line < map_frame.lines && col < map_frame.cols)
+            frame_touch(&map_frame, line, col, cchar_cell(&vec[size_t(c / w)].cstr[c % w]));
+        }
+    }
+  else
+    frame_compose(&map_frame, vec, x, y);
+
+  /* Only the cells changed since the last call reach the terminal */
+  if (map_output == OUTPUT_ANSI)
+    frame_flush_ansi(&map_frame, getbegy(map_frame_window), getbegx(map_frame_window));
+  else
+    {
+      frame_flush(&map_frame, map_frame_window);
+      window_refresh();
+    }
 }
 
+void window_set_output(enum output o)
+{ map_output = o; }
+
 void window_set(const struct builder &builder)
 {
   window_clear();
@@ -301,118 +423,113 @@ bool window_has(struct window *window)
 struct window *window_top(void)
 { return top_window; }
 
-int text_height(const struct text *t, int freecols)
+const struct text_layout *text_layout_update(struct text_layout *l, const struct text *t,
+                                            int width, enum format f)
 {
-  if (!t) return 0;
+  if (l->width == width && l->format == f && l->lenght == t->lenght)
+    return l;
 
-  size_t old = 0;
-  int text_height = 1, templen;
-
-  for (size_t i = 0; i < t->lenght; ++i)
-    if (t->cstr[i].symbol == '\n')
-      {
-        templen = int(i) - int(old);
+  l->width  = width;
+  l->format = f;
+  l->lenght = t->lenght;
+  l->lines.clear();
 
-        text_height +=  ((templen - 1) / freecols + 1);
-        old = i + 1;
-      }
+  if (width <= 0)
+    return l;
 
-  templen = int(t->lenght) - int(old);
+  const struct cchar *s = t->cstr;
+  size_t n = t->lenght;
 
-  text_height += (templen - 1) / freecols;
+  /* Images are centered as a whole by their first line */
+  int block_indent = 0;
 
-  return text_height;
-}
-
-int waddtext(WINDOW *w, const struct text *t, format f)
-{    
-  int rc = OK;
-
-  if (f == FORMAT_CENTER)
+  for (size_t begin = 0; ; )
     {
-      int width = getmaxx(w) - getcurx(w);
-      bool indent_exists = false;
-      int next_line = int(t->lenght) - 1;
+      size_t end = begin;
+      while (end < n && s[end].symbol != '\n')
+        ++end;
+
+      if (begin == 0 && f == FORMAT_CENTER_RIGHT && int(end) <= width)
+        block_indent = std::min((width - int(end))/2 + 1, width - int(end));
 
-      for (int i = 0; i < int(t->lenght); ++i)
+      /* Wrap the line at the last space that fits, or inside the word
+       * if there is none. Images are never wrapped by words */
+      size_t b = begin;
+      do
         {
-          /* When newline */
-          if (getmaxx(w) - getcurx(w) == width)
-            {
-              indent_exists = false;
-
-              next_line = int(t->lenght) - i;
-              for (int n = i; n < int(t->lenght); ++n)
-                if (t->cstr[n].symbol == '\n')
-                  {
-                    next_line = n - i;
-                    break;
-                  }
-            }
+          size_t piece = end - b, next = end;
 
-          if (next_line <= width && !indent_exists)
+          if (piece > size_t(width))
             {
-              indent_exists = true;
-
-              int indent_lenght = (width - next_line)/2;
-              for (int i = 0; i <= indent_lenght; ++i)
-                rc = waddch(w, ' ');
+              piece = size_t(width);
+              next  = b + piece;
+
+              if (f != FORMAT_CENTER_RIGHT)
+                for (size_t k = b + size_t(width); k > b; --k)
+                  if (s[k].symbol == ' ')
+                    {
+                      piece = k - b;
+                      next  = k + 1;
+                      break;
+                    }
             }
 
-          rc = waddcchar(w, &t->cstr[i]);
+          int indent = 0;
+          if (f == FORMAT_CENTER)
+            indent = std::min((width - int(piece))/2 + 1, width - int(piece));
+          else if (f == FORMAT_CENTER_RIGHT)
+            indent = block_indent;
+
+          l->lines.push_back({b, int(piece), indent});
+          b = next;
         }
+      while (b < end);
+
+      if (end >= n)
+        break;
+      begin = end + 1;
     }
-  else if (f == FORMAT_CENTER_RIGHT)
-    {
-      int width = getmaxx(w) - getcurx(w);
-      bool indent_exists = false;
-      int next_newline = int(t->lenght) - 1;
-
-      for (int n = 0; n < int(t->lenght); ++n)
-        if (t->cstr[n].symbol == '\n')
-          {
-            next_newline = n ;
-            break;
-          }
-
-      for (int i = 0; i < int(t->lenght); ++i)
-        {
-          if (getmaxx(w) - getcurx(w) == width)
-            indent_exists = false;
 
-          /* When newline */
-          if (next_newline <= width && !indent_exists)
-            {
-              indent_exists = true;
+  return l;
+}
 
-              int indent_lenght = (width - next_newline)/2;
-              for (int i = 0; i <= indent_lenght; ++i)
-                rc = waddch(w, ' ');
-            }
-          rc = waddcchar(w, &t->cstr[i]);
-        }
-    }
-  else if (f == FORMAT_RIGHT)
+/* Show the lines of l starting with the line first */
+int waddlayout(WINDOW *w, const struct text *t, const struct text_layout *l, int first)
+{
+  int rc = OK;
+  int y = getcury(w), x = getcurx(w);
+
+  for (int i = first; i < int(l->lines.size()) && y + i - first < getmaxy(w); ++i)
     {
-      for (int i = 0; i < int(t->lenght); ++i)
-        rc = waddcchar(w, &t->cstr[i]);
+      const auto &line = l->lines[size_t(i)];
+
+      if ((rc = wmove(w, y + i - first, x + line.indent)) == ERR)
+        break;
+
+      for (int j = 0; j < line.length; ++j)
+        rc = waddcchar(w, &t->cstr[line.begin + size_t(j)]);
     }
+
   return rc;
 }
 
-int waddcchar(WINDOW *w, const struct cchar *t)
+int waddtext(WINDOW *w, const struct text *t)
 {
   int rc = OK;
 
-  if (t->attribute & A_INVIS)
-    return rc = waddch(w, ' ');
+  for (size_t i = 0; i < t->lenght; ++i)
+    rc = waddcchar(w, &t->cstr[i]);
 
-  wattron(w, t->attribute);
-  rc = waddch(w, chtype(t->symbol));
-  wattroff(w, t->attribute);
   return rc;
 }
 
+int waddcchar(WINDOW *w, const struct cchar *t)
+{
+  cchar_t wide;
+  cell_wide(cchar_cell(t), &wide);
+  return wadd_wch(w, &wide);
+}
+
 struct location window_get_location(enum position p)
 { /* Put this text indent as a second border */
   switch (p) {
@@ -471,13 +588,25 @@ static int put_image(struct window *win, const struct text *img, int& nextline)
                                      VERTICAL_INTEND);
 
     nextline += image_height + 1 /* Indent */;
-    return mvwaddtext(win->sub_window_image, 0, 0, img, FORMAT_CENTER_RIGHT);
+    struct text_layout layout;
+    text_layout_update(&layout, img, loc.cols, FORMAT_CENTER_RIGHT);
+    return mvwaddlayout(win->sub_window_image, 0, 0, img, &layout);
 }
 
-static int put_text(struct window *win, const struct text &text, enum format text_format, int& nextline)
+static int put_text(struct window *win, const struct text *text, enum format text_format,
+                    struct text_layout *layout, int menu_lines, int& nextline)
 {
     struct location loc = window_get_location(win->position);
-    int height = text_height(&text, loc.cols);
+
+    /* Texts without a cached layout are laid out with the window */
+    win->layout = layout ? layout : &win->own_layout;
+    win->text = text;
+    win->first_line = 0;
+    text_layout_update(win->layout, win->text, loc.cols, text_format);
+
+    /* Longer texts are paged, the menu below keeps its place */
+    int room = loc.lines + HORIZONTAL_INTEND - nextline - menu_lines;
+    int height = std::max(1, std::min(int(win->layout->lines.size()), room));
 
     /* Text drawing */
     win->sub_window_text = derwin(win->window,
@@ -486,7 +615,7 @@ static int put_text(struct window *win, const struct text &text, enum format tex
                                     nextline,
                                     VERTICAL_INTEND);
     nextline += (height + 1);
-    return mvwaddtext(win->sub_window_text, 0, 0, &text, text_format);
+    return mvwaddlayout(win->sub_window_text, 0, 0, win->text, win->layout);
 }
 
 static int put_menu(struct window *win, const struct item *items, attr_t attribute, int& nextline)
@@ -535,7 +664,7 @@ static int put_menu(struct window *win, const struct item *items, attr_t attribu
     /* Set menu decorations */
     set_menu_mark(win->menu, ITEM_SELECT);
     set_menu_grey(win->menu, A_DIM);
-    set_menu_fore(win->menu, attribute|A_BOLD);
+    set_menu_fore(win->menu, color_curses(attribute)|A_BOLD);
     set_menu_back(win->menu, PAIR(COLOR_WHITE, COLOR_BLACK));
 
     /* Attaching */
@@ -60,6 +60,13 @@ enum option
     OPTION_BORDERLESS = 1 << 0,
 };
 
+/* How the map window reaches the terminal */
+enum output
+{
+  OUTPUT_CURSES,
+  OUTPUT_ANSI,
+};
+
 enum format
 {
   FORMAT_RIGHT,
@@ -87,6 +94,8 @@ struct item
     : label(l), description(d), action(a) {}
 };
 
+/* The hook with the key ERR is called when no key was pressed
+ * for a while, windows without it wait for keys forever */
 struct hook
 {
   int key;
@@ -97,17 +106,42 @@ struct hook
     : key(k), action(a) {} 
 };
 
+/* Lines of a text laid out for a width: line breaks, word wrapping
+ * and indents. A layout kept with its text is reused while the width
+ * (that is the terminal size) and the format stay the same */
+struct text_layout
+{
+  struct line
+  {
+    size_t begin;
+    int    length;
+    int    indent;
+  };
+
+  int          width  = -1;
+  enum format  format = FORMAT_RIGHT;
+  size_t       lenght = 0;
+  vector<line> lines;
+};
+
+const struct text_layout *text_layout_update(struct text_layout *, const struct text *,
+                                            int width, enum format);
+
+/* A text given by pointer is kept by the caller while the window is shown
+ * and the window refers to it, any other text is copied by the window */
 struct builder
 {
   enum position       position;
   struct item        *items;
   struct hook        *hooks;
-  struct text         text;
+  const struct text  *text;
+  struct text         own_text;
   struct text         title;
   enum option         options;
   enum format         text_format;
   const struct text  *image;
   attr_t              attribute;
+  struct text_layout *layout;
 
   builder(enum position p,
           struct item *i,
@@ -117,16 +151,32 @@ struct builder
           enum option o = OPTION_NORMAL,
           enum format ef = FORMAT_CENTER,
           const struct text *im = nullptr,
-          attr_t attr = PAIR(NEUTRAL_COLOR, COLOR_BLACK))
+          attr_t attr = PAIR(NEUTRAL_COLOR, COLOR_BLACK),
+          struct text_layout *l = nullptr)
     : position(p),
       items(i),
       hooks(h),
-      text(t),
+      text(nullptr),
+      own_text(t),
       title(e),
       options(o),
       text_format(ef),
       image(im),
-      attribute(attr) {}
+      attribute(attr),
+      layout(l) {}
+
+  builder(enum position p,
+          struct item *i,
+          struct hook *h,
+          const struct text *t,
+          const struct text &e,
+          enum option o = OPTION_NORMAL,
+          enum format ef = FORMAT_CENTER,
+          const struct text *im = nullptr,
+          attr_t attr = PAIR(NEUTRAL_COLOR, COLOR_BLACK),
+          struct text_layout *l = nullptr)
+    : builder(p, i, h, ::text(), e, o, ef, im, attr, l)
+  { text = t; }
 };
 
 window *window_push(const builder &builder);
@@ -134,6 +184,9 @@ void window_pop(void);
 void window_refresh(void);
 void window_hook(void);
 void window_menu_driver(int);
+/* Scroll the text of the top window by pages, the last line of a page
+ * stays on the screen */
+void window_text_scroll(int pages);
 void window_set(const builder &);
 void window_clear(void);
 
@@ -141,7 +194,9 @@ bool window_has(struct window *);
 window *window_top(void);
 
 /* For map rendering */
-void window_print(const vector<text> &, int x, int y);
+void window_print(const vector<text> &, int x, int y, int view_x, int view_y,
+                  const vector<int> *cells);
+void window_set_output(enum output);
 
 struct location window_get_location(enum position);
 